@@ -0,0 +1,27 @@
+// Compile-time and code-size benchmark: `make bench` reports how long this file takes to
+// compile and the size of the resulting object. It contains many different combinations
+// of arguments, as they appear in real code.
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../src/include/yoga.hpp"
+
+#define YOGA_BENCH_CALLS(i) \
+	YOGA_INFO("int: ", i, " double: ", i * 0.5, " char: ", 'c'); \
+	YOGA_WARNF("%s of %s: %s", i, 100u, std::string{"foo"}); \
+	YOGA_ERROR(i, ' ', i + 1l, ' ', i + 2ul, ' ', i * 1.5f, ' ', true); \
+	YOGA_DEBUGF("vector: %s, pair: %s", std::vector<decltype(i)>{i, i}, std::make_pair(i, "bar")); \
+	yoga::writeln("line ", i, ": ", std::map<decltype(i), double>{{i, 2.5}}); \
+	yoga::writefln("%s|%s|%s|%s", i, -i, 'x', "baz");
+
+void bench_0(int i) {YOGA_BENCH_CALLS(i)}
+void bench_1(short i) {YOGA_BENCH_CALLS(i)}
+void bench_2(long i) {YOGA_BENCH_CALLS(i)}
+void bench_3(long long i) {YOGA_BENCH_CALLS(i)}
+void bench_4(unsigned i) {YOGA_BENCH_CALLS(i)}
+void bench_5(unsigned long i) {YOGA_BENCH_CALLS(i)}
+void bench_6(unsigned short i) {YOGA_BENCH_CALLS(i)}
+void bench_7(unsigned long long i) {YOGA_BENCH_CALLS(i)}
@@ -2,11 +2,14 @@
 #define YOGA_FORMAT_HPP
 
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstddef>
 #include <string>
 #include <sstream>
 #include <stdexcept>
 #include <iterator>
+#include <limits>
 #include <type_traits>
 #include <tuple>
 #include <utility>
@@ -27,6 +30,46 @@ std::string format(const std::string& format, const T&...args);
 template<typename...T>
 std::ostream& print_to_stream_formated(std::ostream& stream, const std::string& format, const T&...args);
 
+namespace settings {
+
+// Containers with more elements are cut off after max_elements and end with
+// “... (n more)”; containers that are nested deeper than max_depth are printed
+// as “[...]”. Both are unlimited by default.
+void set_max_elements(std::size_t n);
+std::size_t get_max_elements();
+
+void set_max_depth(std::size_t n);
+std::size_t get_max_depth();
+}
+
+// Wrappers for raw bytes: hex prints them as compact lowercase hex-digits (“0aff10”),
+// hexdump in the classic layout of offset, hex-bytes and ASCII (like `hexdump -C`).
+// They only refer to the data, which has to outlive them.
+template<typename Tag>
+class basic_byte_view {
+public:
+	basic_byte_view(const void* data, std::size_t size):
+		data{static_cast<const unsigned char*>(data)}, size{size} {}
+	
+	template<typename Container,
+		class Pointer = decltype(std::declval<const Container&>().data()),
+		YOGA_REQUIRE_N(IsByteRange, std::is_pointer<Pointer>::value
+			&& sizeof(typename std::remove_pointer<Pointer>::type) == 1)>
+	explicit basic_byte_view(const Container& container):
+		basic_byte_view{container.data(), static_cast<std::size_t>(container.size())} {}
+	
+	const unsigned char* data;
+	std::size_t size;
+};
+
+namespace impl {
+struct hex_view_tag{};
+struct hexdump_view_tag{};
+}
+
+using hex = basic_byte_view<impl::hex_view_tag>;
+using hexdump = basic_byte_view<impl::hexdump_view_tag>;
+
 // Implementation
 /////////////////
 
@@ -38,6 +81,8 @@ namespace impl {
 enum class printable_category {
 	unprintable,
 	iteratable,
+	arithmetic_range,
+	byte_view,
 	pair,
 	tuple,
 	streamable,
@@ -47,27 +92,35 @@ template<typename T> constexpr bool is_streamable();
 template<typename T> constexpr bool is_pair();
 template<typename T> constexpr bool is_tuple();
 template<typename T> constexpr bool is_iteratable();
+template<typename T> constexpr bool is_arithmetic_range();
+template<typename T> constexpr bool is_byte_view();
 
 template<typename T>
 constexpr printable_category getprintable_category() {
 	return
-		is_streamable<T>() ? printable_category::streamable  :
-		is_pair<T>()       ? printable_category::pair        :
-		is_tuple<T>()      ? printable_category::tuple       :
-		is_iteratable<T>() ? printable_category::iteratable  :
-		/* else: */          printable_category::unprintable ;
+		is_byte_view<T>()        ? printable_category::byte_view        :
+		is_streamable<T>()       ? printable_category::streamable       :
+		is_pair<T>()             ? printable_category::pair             :
+		is_tuple<T>()            ? printable_category::tuple            :
+		is_arithmetic_range<T>() ? printable_category::arithmetic_range :
+		is_iteratable<T>()       ? printable_category::iteratable       :
+		/* else: */                printable_category::unprintable      ;
 }
 template<printable_category Tag> struct printable_category_tag{};
-using iteratable_tag   = printable_category_tag< printable_category::iteratable  >;
-using pair_tag         = printable_category_tag< printable_category::pair        >;
-using tuple_tag        = printable_category_tag< printable_category::tuple       >;
-using streamable_tag   = printable_category_tag< printable_category::streamable  >;
-using unprintable_tag  = printable_category_tag< printable_category::unprintable >;
+using iteratable_tag       = printable_category_tag< printable_category::iteratable       >;
+using arithmetic_range_tag = printable_category_tag< printable_category::arithmetic_range >;
+using byte_view_tag        = printable_category_tag< printable_category::byte_view        >;
+using pair_tag             = printable_category_tag< printable_category::pair             >;
+using tuple_tag            = printable_category_tag< printable_category::tuple            >;
+using streamable_tag       = printable_category_tag< printable_category::streamable       >;
+using unprintable_tag      = printable_category_tag< printable_category::unprintable      >;
 
 template<typename T, typename...Args> void print_to_stream(std::ostream& stream, const T&, const Args&...);
 inline void print_to_stream(std::ostream&) {}
 
 template<typename T> void print_to_stream_tagged(std::ostream& stream, const T&, iteratable_tag);
+template<typename T> void print_to_stream_tagged(std::ostream& stream, const T&, arithmetic_range_tag);
+template<typename T> void print_to_stream_tagged(std::ostream& stream, const T&, byte_view_tag);
 template<typename T> void print_to_stream_tagged(std::ostream& stream, const T&, pair_tag);
 template<typename T> void print_to_stream_tagged(std::ostream& stream, const T&, tuple_tag);
 template<typename T> void print_to_stream_tagged(std::ostream& stream, const T&, streamable_tag);
@@ -85,62 +138,6 @@ void print_to_stream(std::ostream& stream, const T& arg, const Args&...args) {
 	print_to_stream(stream, args...);
 }
 
-inline std::tuple<std::string::const_iterator, bool> printFormatPartToStream(std::ostream& stream,
-		std::string::const_iterator begin, std::string::const_iterator end);
-
-inline void print_to_stream_formated(std::ostream& stream, std::string::const_iterator format_begin,
-		std::string::const_iterator format_end) {
-	bool print_argument;
-	using iterator = std::string::const_iterator;
-	iterator it;
-	std::tie(it, print_argument) = printFormatPartToStream(stream, format_begin, format_end);
-	if (print_argument) {
-		throw std::invalid_argument{"formatstring requests more arguments then provided"};
-	}
-}
-template<typename T, typename...Args>
-void print_to_stream_formated(std::ostream& stream, std::string::const_iterator format_begin,
-		std::string::const_iterator format_end, const T& arg, const Args&...args) {
-	bool print_argument;
-	using iterator = std::string::const_iterator;
-	iterator it;
-	std::tie(it, print_argument) = printFormatPartToStream(stream, format_begin, format_end);
-	if(print_argument) {
-		print_to_stream(stream, arg);
-		print_to_stream_formated(stream, it, format_end, args...);
-	} else {
-		assert(it == format_end);
-		return;
-	}
-}
-
-inline std::tuple<std::string::const_iterator, bool> printFormatPartToStream(std::ostream& stream,
-		std::string::const_iterator begin, std::string::const_iterator end) {
-	if (begin == end) {
-		return std::make_tuple(end, false);
-	}
-	while (true) {
-		auto nextPercent = std::find(begin, end, '%');
-		stream.write(&*begin, nextPercent-begin);
-		if(nextPercent == end) {
-			return std::make_tuple(end, false);
-		} else {
-			begin = ++nextPercent;
-			if(begin == end) {
-				throw std::invalid_argument{"formatstrings must not end on unmatched '%'"};
-			} else if (*begin == '%') {
-				stream.put('%');
-				++begin;
-			} else if (*begin == 's') {
-				++begin;
-				return std::make_tuple(begin, true);
-			} else {
-				throw std::invalid_argument{"formatstring contains illegal format-specifier"};
-			}
-		}
-	}
-}
-
 // Brace Yourself: Templatemetaprogramming is comming
 /////////////////////////////////////////////////////
 
@@ -159,6 +156,27 @@ template<typename T> constexpr bool is_iteratable() {
 	return decltype(is_iteratable_helper::is_iteratable(std::declval<T>()))::value;
 }
 
+// arithmetic range: contiguous memory of one of the types that print_arithmetic_range
+// is instantiated for
+template<typename T> constexpr bool is_range_arithmetic() {
+	using U = typename std::remove_cv<T>::type;
+	return std::is_arithmetic<U>::value && !is_same<U, wchar_t>()
+		&& !is_same<U, char16_t>() && !is_same<U, char32_t>();
+}
+struct is_arithmetic_range_helper {
+	static std::false_type is_arithmetic_range(...);
+	
+	template<typename T,
+		class Pointer = decltype(std::declval<const T&>().data()),
+		YOGA_REQUIRE_N(HasSize, std::is_integral<decltype(std::declval<const T&>().size())>::value),
+		YOGA_REQUIRE_N(IsPointer, std::is_pointer<Pointer>::value),
+		YOGA_REQUIRE_N(IsArithmetic, is_range_arithmetic<typename std::remove_pointer<Pointer>::type>())
+	> static std::true_type is_arithmetic_range(const T&);
+};
+template<typename T> constexpr bool is_arithmetic_range() {
+	return decltype(is_arithmetic_range_helper::is_arithmetic_range(std::declval<T>()))::value;
+}
+
 // pair
 template<typename T              > struct is_pair_helper                    : std::false_type {};
 template<typename T1, typename T2> struct is_pair_helper<std::pair<T1, T2>> : std::true_type {};
@@ -173,6 +191,13 @@ template<typename T> constexpr bool is_tuple() {
 	return is_tuple_helper<T>::value;
 }
 
+// byte view
+template<typename T> struct is_byte_view_helper                      : std::false_type {};
+template<typename T> struct is_byte_view_helper<basic_byte_view<T>> : std::true_type {};
+template<typename T> constexpr bool is_byte_view() {
+	return is_byte_view_helper<T>::value;
+}
+
 // streamable
 struct is_streamable_helper {
 	static std::false_type is_streamable(...);
@@ -197,6 +222,21 @@ template<typename T> void print_to_stream_tagged(std::ostream& stream, const T&
 	stream << arg;
 }
 
+// byte view
+// Compiled into the library; the conversion to hex-digits uses SSE2 or AVX2 where available.
+void print_hex(std::ostream& stream, const unsigned char* data, std::size_t size);
+void print_hexdump(std::ostream& stream, const unsigned char* data, std::size_t size);
+
+inline void print_byte_view(std::ostream& stream, const hex& arg) {
+	print_hex(stream, arg.data, arg.size);
+}
+inline void print_byte_view(std::ostream& stream, const hexdump& arg) {
+	print_hexdump(stream, arg.data, arg.size);
+}
+template<typename T> void print_to_stream_tagged(std::ostream& stream, const T& arg, byte_view_tag) {
+	print_byte_view(stream, arg);
+}
+
 // pair
 template<typename T> void print_to_stream_tagged(std::ostream& stream, const T& arg, pair_tag) {
 	stream << '(';
@@ -225,25 +265,228 @@ template<typename T> void print_to_stream_tagged(std::ostream& stream, const T&
 	stream << ')';
 }
 
+// Counts how deeply containers are nested while they are printed:
+class container_depth_guard {
+public:
+	container_depth_guard();
+	~container_depth_guard();
+	container_depth_guard(const container_depth_guard&) = delete;
+	container_depth_guard& operator=(const container_depth_guard&) = delete;
+	
+	bool exceeded() const;
+};
+
+// remaining may be unknown_remaining if the number of elements that were left out is unknown:
+constexpr std::size_t unknown_remaining = std::numeric_limits<std::size_t>::max();
+void print_elision(std::ostream& stream, bool first, std::size_t remaining);
+
+// The number of elements that follow the printed ones: containers know their size, other
+// ranges are walked, unless walking them would consume them.
+template<typename T, typename Iterator,
+	YOGA_REQUIRE_N(HasSize, std::is_integral<decltype(std::declval<const T&>().size())>::value)>
+std::size_t remaining_elements(const T& arg, Iterator, Iterator, std::size_t printed, int) {
+	return static_cast<std::size_t>(arg.size()) - printed;
+}
+template<typename T, typename Iterator,
+	YOGA_REQUIRE_N(IsForwardIterator, is_base_or_same<std::forward_iterator_tag,
+		typename std::iterator_traits<Iterator>::iterator_category>())>
+std::size_t remaining_elements(const T&, Iterator it, Iterator end, std::size_t, long) {
+	return static_cast<std::size_t>(std::distance(it, end));
+}
+template<typename T, typename Iterator>
+std::size_t remaining_elements(const T&, Iterator, Iterator, std::size_t, ...) {
+	return unknown_remaining;
+}
+
 // iteratable
 template<typename T> void print_to_stream_tagged(std::ostream& stream, const T& arg, iteratable_tag) {
+	container_depth_guard guard;
+	if(guard.exceeded()) {
+		stream << "[...]";
+		return;
+	}
+	const auto max_elements = settings::get_max_elements();
 	auto it = std::begin(arg);
 	auto end = std::end(arg);
-	bool firstpass = true;
+	std::size_t printed = 0;
 	stream << '[';
 	while(it != end) {
-		if(firstpass) {
-			firstpass = false;
+		if(printed == max_elements) {
+			print_elision(stream, printed == 0, remaining_elements(arg, it, end, printed, 0));
+			break;
 		}
-		else {
+		if(printed > 0) {
 			stream << ", ";
 		}
 		print_to_stream(stream, *it);
 		++it;
+		++printed;
 	}
 	stream << ']';
 }
 
+// arithmetic range
+// Compiled into the library for every arithmetic type, except for the wide characters.
+// The elements are converted in batches into a local buffer if the stream uses the
+// default-formatting.
+template<typename T> void print_arithmetic_range(std::ostream& stream, const T* data, std::size_t size);
+
+template<typename T> void print_to_stream_tagged(std::ostream& stream, const T& arg, arithmetic_range_tag) {
+	container_depth_guard guard;
+	if(guard.exceeded()) {
+		stream << "[...]";
+		return;
+	}
+	print_arithmetic_range(stream, arg.data(), static_cast<std::size_t>(arg.size()));
+}
+
+// Type-erasure for the public interface
+////////////////////////////////////////
+
+// The arguments of the public functions are passed to the compiled library as an array of
+// format_args, so that the call site only has to build that array instead of instantiating
+// the whole printing-machinery for every combination of arguments. Common types are stored
+// by value, everything else as a pointer together with a printing-function for its type.
+// Functions (like the manipulators std::hex or std::boolalpha) can't be pointed to by
+// a const void*, so they get their own kind.
+// Integers are widened for storage, but remember their original size, so that they can be
+// narrowed again before printing: std::hex prints the two's complement of the original
+// type (-1 as short is "ffff", not "ffffffffffffffff").
+struct format_arg {
+	enum class kind {
+		boolean,
+		character,
+		signed_integer,
+		unsigned_integer,
+		floating,
+		long_floating,
+		c_string,
+		string,
+		function,
+		generic
+	};
+	using print_function = void(*)(std::ostream&, const void*);
+	struct generic_value {
+		const void* arg;
+		print_function print;
+	};
+	using any_function = void(*)();
+	using print_function_function = void(*)(std::ostream&, any_function);
+	struct function_value {
+		any_function arg;
+		print_function_function print;
+	};
+	
+	format_arg(bool arg): type{kind::boolean} {value.boolean = arg;}
+	format_arg(char arg): type{kind::character} {value.character = arg;}
+	format_arg(long long arg, std::size_t size = sizeof(long long))
+		: type{kind::signed_integer}, integer_size{static_cast<unsigned char>(size)} {value.signed_integer = arg;}
+	format_arg(unsigned long long arg, std::size_t size = sizeof(unsigned long long))
+		: type{kind::unsigned_integer}, integer_size{static_cast<unsigned char>(size)} {value.unsigned_integer = arg;}
+	format_arg(double arg): type{kind::floating} {value.floating = arg;}
+	format_arg(long double arg): type{kind::long_floating} {value.long_floating = arg;}
+	format_arg(const char* arg): type{kind::c_string} {value.c_string = arg;}
+	format_arg(const std::string& arg): type{kind::string} {value.string = &arg;}
+	format_arg(any_function arg, print_function_function print): type{kind::function} {value.function = {arg, print};}
+	format_arg(const void* arg, print_function print): type{kind::generic} {value.generic = {arg, print};}
+	
+	kind type;
+	unsigned char integer_size = 0;
+	union {
+		bool boolean;
+		char character;
+		long long signed_integer;
+		unsigned long long unsigned_integer;
+		double floating;
+		long double long_floating;
+		const char* c_string;
+		const std::string* string;
+		function_value function;
+		generic_value generic;
+	} value;
+};
+
+template<format_arg::kind Kind> struct format_arg_kind_tag{};
+
+template<typename T>
+constexpr format_arg::kind get_format_arg_kind() {
+	using U = typename std::remove_cv<T>::type;
+	return
+		is_same<U, bool>() ? format_arg::kind::boolean :
+		is_same<U, char>() || is_same<U, signed char>() || is_same<U, unsigned char>()
+			? format_arg::kind::character :
+		// the other character-types keep the behaviour of the stream:
+		is_same<U, wchar_t>() || is_same<U, char16_t>() || is_same<U, char32_t>()
+			? format_arg::kind::generic :
+		std::is_integral<U>::value && std::is_signed<U>::value ? format_arg::kind::signed_integer :
+		std::is_integral<U>::value ? format_arg::kind::unsigned_integer :
+		is_same<U, float>() || is_same<U, double>() ? format_arg::kind::floating :
+		is_same<U, long double>() ? format_arg::kind::long_floating :
+		is_same<U, std::string>() ? format_arg::kind::string :
+		is_same<decay<U>, char*>() || is_same<decay<U>, const char*>() ? format_arg::kind::c_string :
+		std::is_function<U>::value ? format_arg::kind::function :
+		/* else: */ format_arg::kind::generic;
+}
+
+template<typename T>
+void print_generic_arg(std::ostream& stream, const void* arg) {
+	print_to_stream(stream, *static_cast<const T*>(arg));
+}
+
+// T is a function-type, which is restored by casting back to its original type:
+template<typename T>
+void print_function_arg(std::ostream& stream, format_arg::any_function arg) {
+	print_to_stream(stream, *reinterpret_cast<T*>(arg));
+}
+
+template<typename T> format_arg make_format_arg(const T& arg, format_arg_kind_tag<format_arg::kind::boolean>) {
+	return format_arg{static_cast<bool>(arg)};
+}
+template<typename T> format_arg make_format_arg(const T& arg, format_arg_kind_tag<format_arg::kind::character>) {
+	return format_arg{static_cast<char>(arg)};
+}
+template<typename T> format_arg make_format_arg(const T& arg, format_arg_kind_tag<format_arg::kind::signed_integer>) {
+	return format_arg{static_cast<long long>(arg), sizeof(T)};
+}
+template<typename T> format_arg make_format_arg(const T& arg, format_arg_kind_tag<format_arg::kind::unsigned_integer>) {
+	return format_arg{static_cast<unsigned long long>(arg), sizeof(T)};
+}
+template<typename T> format_arg make_format_arg(const T& arg, format_arg_kind_tag<format_arg::kind::floating>) {
+	return format_arg{static_cast<double>(arg)};
+}
+template<typename T> format_arg make_format_arg(const T& arg, format_arg_kind_tag<format_arg::kind::long_floating>) {
+	return format_arg{static_cast<long double>(arg)};
+}
+template<typename T> format_arg make_format_arg(const T& arg, format_arg_kind_tag<format_arg::kind::c_string>) {
+	return format_arg{static_cast<const char*>(arg)};
+}
+template<typename T> format_arg make_format_arg(const T& arg, format_arg_kind_tag<format_arg::kind::string>) {
+	return format_arg{static_cast<const std::string&>(arg)};
+}
+template<typename T> format_arg make_format_arg(const T& arg, format_arg_kind_tag<format_arg::kind::function>) {
+	return format_arg{reinterpret_cast<format_arg::any_function>(&arg), &print_function_arg<T>};
+}
+template<typename T> format_arg make_format_arg(const T& arg, format_arg_kind_tag<format_arg::kind::generic>) {
+	return format_arg{static_cast<const void*>(&arg), &print_generic_arg<T>};
+}
+
+template<typename T> format_arg make_format_arg(const T& arg) {
+	static_assert(getprintable_category<T>() != printable_category::unprintable,
+			"print_to_stream must not be called with an unprintable argument");
+	return make_format_arg(arg, format_arg_kind_tag<get_format_arg_kind<T>()>{});
+}
+
+template<typename...T>
+std::array<format_arg, sizeof...(T)> make_format_args(const T&...args) {
+	return {{make_format_arg(args)...}};
+}
+
+// These are compiled into the library:
+void print_format_args(std::ostream& stream, const format_arg* args, std::size_t n);
+void print_format_args_formated(std::ostream& stream, const std::string& format,
+		const format_arg* args, std::size_t n);
+std::string format_args_to_string(const format_arg* args, std::size_t n);
+std::string format_args_formated(const std::string& format, const format_arg* args, std::size_t n);
 
 } // namespace impl
 
@@ -252,27 +495,27 @@ template<typename T> void print_to_stream_tagged(std::ostream& stream, const T&
 
 template<typename...T>
 std::string to_string(const T&...args) {
-	std::stringstream stream;
-	print_to_stream(stream, args...);
-	return stream.str();
+	const auto arg_array = impl::make_format_args(args...);
+	return impl::format_args_to_string(arg_array.data(), arg_array.size());
 }
 
 template<typename...T>
 std::ostream& print_to_stream(std::ostream& stream, const T&...args) {
-	impl::print_to_stream(stream, args...);
+	const auto arg_array = impl::make_format_args(args...);
+	impl::print_format_args(stream, arg_array.data(), arg_array.size());
 	return stream;
 }
 
 template<typename...T>
 std::string format(const std::string& format, const T&...args) {
-	std::stringstream stream;
-	print_to_stream_formated(stream, format, args...);
-	return stream.str();
+	const auto arg_array = impl::make_format_args(args...);
+	return impl::format_args_formated(format, arg_array.data(), arg_array.size());
 }
 
 template<typename...T>
 std::ostream& print_to_stream_formated(std::ostream& stream, const std::string& format, const T&...args) {
-	impl::print_to_stream_formated(stream, format.begin(), format.end(), args...);
+	const auto arg_array = impl::make_format_args(args...);
+	impl::print_format_args_formated(stream, format, arg_array.data(), arg_array.size());
 	return stream;
 }
 
@@ -0,0 +1,66 @@
+#ifndef YOGA_LOGFILE_HPP
+#define YOGA_LOGFILE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "print.hpp"
+
+namespace yoga {
+
+namespace settings {
+
+// Let the next logfile maintain a sidecar-index “<logfile>.idx” with an entry every
+// interval_kib KiB, that read_logfile uses to seek to the requested time-range.
+// 0 disables the index. Takes effect with the next call to set_logfile.
+void set_logfile_index(std::size_t interval_kib);
+std::size_t get_logfile_index();
+}
+
+struct log_record {
+	std::chrono::time_point<std::chrono::system_clock> time;
+	priority prio;
+	std::string text; // the complete record as written to the logfile, without the final newline
+};
+
+// Calls callback for every record in the logfile with a time in [begin, end) and at least
+// min_priority. If the logfile has an index, reading starts close to the first matching
+// record instead of at the start of the file. Records of different threads may be written
+// slightly out of order, so the search stops only once a record is a second past end.
+void read_logfile(const std::string& filename,
+		const std::chrono::time_point<std::chrono::system_clock>& begin,
+		const std::chrono::time_point<std::chrono::system_clock>& end,
+		priority min_priority, const std::function<void(const log_record&)>& callback);
+
+// IMPLEMENATION
+/////////////////////////////////////////////////////////////
+
+namespace impl {
+
+// The index is an array of these, in native byte-order:
+struct logfile_index_entry {
+	std::int64_t max_time; // the latest time of all records before offset
+	std::uint64_t offset;  // the start of a record
+};
+
+// Parses the “[time] [Prio]” that starts every record in the logfile.
+bool parse_logline_header(const std::string& line, std::int64_t& time, priority& p);
+
+// Records of different threads are out of order by at most this much:
+constexpr std::chrono::seconds max_disorder{1};
+
+// Whether entry (the last one of an existing index) still describes the logfile, which
+// isn't the case anymore if the logfile was rotated or truncated since.
+bool index_entry_matches(const std::string& filename, const logfile_index_entry& entry);
+
+// An upper bound for the times of all records in the first size bytes of the logfile,
+// derived from the last records: their latest time plus max_disorder.
+std::int64_t estimate_max_time(const std::string& filename, std::uint64_t size);
+
+} // namespace impl
+
+} // namespace yoga
+
+#endif
@@ -3,6 +3,8 @@
 
 
 #include "print.hpp"
+#include "trace.hpp"
+#include "util.hpp"
 
 #ifdef YOGA_NO_LOGGING
 
@@ -21,6 +23,7 @@
 #define YOGA_TRACEF(...) do{}while(false)
 
 #define YOGA_TRACEPOINT do{}while(false)
+#define YOGA_TRACESPAN  do{}while(false)
 
 #ifdef YOGA_USE_UNCLEAN_MACROS
 #define FATAL(...) do{}while(false)
@@ -38,6 +41,7 @@
 #define TRACEF(...) do{}while(false)
 
 #define TRACEPOINT do{}while(false)
+#define TRACESPAN  do{}while(false)
 #endif
 
 #else // NOLOGGING
@@ -68,8 +72,9 @@
 #define YOGA_TRACEF(...) ::yoga::impl::logf({__FILE__, __PRETTY_FUNCTION__, __LINE__},\
 		::yoga::priority::trace, __VA_ARGS__)
 
-#define YOGA_TRACEPOINT ::yoga::impl::log({__FILE__, __PRETTY_FUNCTION__, __LINE__},\
-		::yoga::priority::trace, "tracepoint")
+#define YOGA_TRACEPOINT ::yoga::impl::tracepoint({__FILE__, __PRETTY_FUNCTION__, __LINE__})
+#define YOGA_TRACESPAN  ::yoga::impl::span YOGA_UNIQUE_NAME(yoga_span_)\
+		{{__FILE__, __PRETTY_FUNCTION__, __LINE__}}
 
 
 #ifdef YOGA_USE_UNCLEAN_MACROS
@@ -100,8 +105,9 @@
 #define TRACEF(...) ::yoga::impl::logf({__FILE__, __PRETTY_FUNCTION__, __LINE__},\
 		::yoga::priority::trace, __VA_ARGS__)
 
-#define TRACEPOINT ::yoga::impl::log({__FILE__, __PRETTY_FUNCTION__, __LINE__},\
-		::yoga::priority::trace, "tracepoint")
+#define TRACEPOINT ::yoga::impl::tracepoint({__FILE__, __PRETTY_FUNCTION__, __LINE__})
+#define TRACESPAN  ::yoga::impl::span YOGA_UNIQUE_NAME(yoga_span_)\
+		{{__FILE__, __PRETTY_FUNCTION__, __LINE__}}
 
 #endif // unclean macros
 
@@ -1,6 +1,7 @@
 #ifndef YOGA_PRINT_HPP
 #define YOGA_PRINT_HPP
 
+#include <chrono>
 #include <iosfwd>
 #include <iostream>
 #include <mutex>
@@ -36,8 +37,36 @@ void set_print_location(bool b);
 bool get_print_location();
 
 void set_logfile(const std::string& filename);
+
+// Send the write-family through a large private buffer that is written to the
+// stdout-filedescriptor directly instead of through the synchronized std::cout.
+// The buffer is flushed when it is full, by yoga::flush(), when buffering is
+// disabled again and at exit. Buffered output is not synchronized with std::cout,
+// the logger or other threads.
+void set_buffered_stdout(bool b);
+bool get_buffered_stdout();
+
+enum class socket_framing {
+	rfc5424, // syslog-protocol; octet-counted (RFC 6587) on stream-sockets
+	newline  // the same lines that are written to the logfile
+};
+
+// Send all log-records to the unix-domain-socket at path (datagram or stream).
+// Records are queued and sent in batches by a background-thread that also takes
+// care of reconnecting, so logging never blocks on the socket. If the queue
+// overflows while the collector is unavailable, records are dropped.
+// An empty path closes the socket after trying to send the remaining records for at
+// most a second.
+void set_logsocket(const std::string& path, socket_framing framing = socket_framing::rfc5424);
+
+// The number of records that were dropped since the last call to set_logsocket, because the
+// queue overflowed or because they could not be delivered within a second of closing.
+std::size_t get_logsocket_dropped();
 }
 
+// Flush everything that was written by the write-family so far.
+void flush();
+
 template<typename...Args>
 void write(const Args&...args);
 
@@ -67,6 +96,17 @@ void swritefln(std::ostream& stream, const std::string& format, const Args&...ar
 /////////////////////////////////////////////////////////////
 
 namespace impl {
+std::ostream& get_stdout();
+
+// The line that is written to the logfile for a record, including the trailing newline.
+std::string format_logline(const location& loc, priority p,
+		const std::chrono::time_point<std::chrono::system_clock>& time_point,
+		const std::string& msg);
+
+void log_to_socket(const location& loc, priority p,
+		const std::chrono::time_point<std::chrono::system_clock>& time_point,
+		const std::string& msg);
+
 void log(const location& loc, priority p, const std::string msg);
 
 template<typename...T>
@@ -87,22 +127,24 @@ void logf(const location& loc, priority p, const std::string& formatstring, cons
 
 template<typename...Args>
 void write(const Args&...args) {
-	print_to_stream(std::cout, args...);
+	print_to_stream(impl::get_stdout(), args...);
 }
 
 template<typename...Args>
 void writeln(const Args&...args) {
-	print_to_stream(std::cout, args..., '\n');
+	print_to_stream(impl::get_stdout(), args..., '\n');
 }
 
 template<typename...Args>
 void writef(const std::string& formatstring, const Args&...args) {
-	print_to_stream_formated(std::cout, formatstring, args...);
+	print_to_stream_formated(impl::get_stdout(), formatstring, args...);
 }
 
 template<typename...Args>
 void writefln(const std::string& formatstring, const Args&...args) {
-	print_to_stream_formated(std::cout, formatstring + '\n', args...);
+	auto& stream = impl::get_stdout();
+	print_to_stream_formated(stream, formatstring, args...);
+	stream.put('\n');
 }
 
 template<typename...Args>
@@ -122,7 +164,8 @@ void swritef(std::ostream& stream, const std::string& formatstring, const Args&.
 
 template<typename...Args>
 void swritefln(std::ostream& stream, const std::string& formatstring, const Args&...args) {
-	print_to_stream_formated(stream, formatstring + '\n', args...);
+	print_to_stream_formated(stream, formatstring, args...);
+	stream.put('\n');
 }
 
 } // namespace yoga
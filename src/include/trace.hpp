@@ -0,0 +1,51 @@
+#ifndef YOGA_TRACE_HPP
+#define YOGA_TRACE_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "print.hpp"
+
+namespace yoga {
+
+namespace settings {
+
+// Write spans and tracepoints as Chrome/Perfetto trace-event JSON to filename.
+// An empty filename closes the current tracefile. The events that any thread has
+// buffered so far are written to the old file before it is closed.
+void set_tracefile(const std::string& filename);
+bool get_tracing();
+}
+
+// Hand the calling thread's buffered trace-events over to the tracefile.
+// Buffers are also flushed when they are full and when their thread exits.
+void flush_trace();
+
+// IMPLEMENATION
+/////////////////////////////////////////////////////////////
+
+namespace impl {
+
+// Measures the time between its construction and destruction. Use it via YOGA_TRACESPAN.
+class span {
+public:
+	explicit span(const location& loc);
+	~span();
+	
+	span(const span&) = delete;
+	span& operator=(const span&) = delete;
+	
+private:
+	const location loc;
+	std::int64_t begin;
+	bool active;
+};
+
+// Logs "tracepoint" and records an instant-event if tracing is enabled.
+void tracepoint(const location& loc);
+
+} // namespace impl
+
+} // namespace yoga
+
+#endif
@@ -6,6 +6,16 @@
 #define YOGA_REQUIRE(...) class = typename ::std::enable_if<__VA_ARGS__>::type
 #define YOGA_REQUIRE_N(what, ...) class what = typename ::std::enable_if<__VA_ARGS__>::type
 
+#define YOGA_CONCAT_IMPL(a, b) a##b
+#define YOGA_CONCAT(a, b) YOGA_CONCAT_IMPL(a, b)
+
+// A name that is unique within the translation-unit (only per line without __COUNTER__):
+#ifdef __COUNTER__
+#define YOGA_UNIQUE_NAME(prefix) YOGA_CONCAT(prefix, __COUNTER__)
+#else
+#define YOGA_UNIQUE_NAME(prefix) YOGA_CONCAT(prefix, __LINE__)
+#endif
+
 namespace yoga {
 
 template<typename T> using decay = typename std::decay<T>::type;
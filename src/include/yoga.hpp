@@ -2,7 +2,9 @@
 #define YOGA_YOGA_HPP
 
 #include "format.hpp"
+#include "logfile.hpp"
 #include "print.hpp"
+#include "trace.hpp"
 #include "util.hpp"
 #include "macros.hpp"
 
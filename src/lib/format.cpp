@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+#include "../include/format.hpp"
+
+namespace yoga {
+
+namespace settings {
+
+namespace {
+std::size_t max_elements = std::numeric_limits<std::size_t>::max();
+std::size_t max_depth = std::numeric_limits<std::size_t>::max();
+}
+
+void set_max_elements(std::size_t n) {max_elements = n;}
+std::size_t get_max_elements() {return max_elements;}
+
+void set_max_depth(std::size_t n) {max_depth = n;}
+std::size_t get_max_depth() {return max_depth;}
+
+} // namespace settings
+
+namespace impl {
+
+namespace {
+
+thread_local std::size_t container_depth = 0;
+
+// Whether the output of the arithmetic types may be produced without the stream:
+bool has_default_format(const std::ostream& stream) {
+	const auto flags = stream.flags() & ~(std::ios_base::skipws | std::ios_base::unitbuf);
+	return flags == std::ios_base::dec && stream.width() == 0 && stream.precision() >= 0
+		&& stream.precision() <= 20 && stream.getloc() == std::locale::classic();
+}
+
+// The maximum number of characters that write_element may produce with the format above:
+constexpr std::size_t max_element_size = 64;
+
+template<typename T>
+std::size_t write_unsigned(char* out, T value) {
+	char digits[std::numeric_limits<T>::digits10 + 1];
+	std::size_t n = 0;
+	do {
+		digits[n++] = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while(value != 0);
+	std::reverse_copy(digits, digits + n, out);
+	return n;
+}
+
+template<typename T>
+std::size_t write_integer(char* out, T value, std::true_type /*signed*/) {
+	using unsigned_type = typename std::make_unsigned<T>::type;
+	if(value < 0) {
+		*out = '-';
+		return 1 + write_unsigned(out + 1, static_cast<unsigned_type>(0u - static_cast<unsigned_type>(value)));
+	}
+	return write_unsigned(out, static_cast<unsigned_type>(value));
+}
+
+template<typename T>
+std::size_t write_integer(char* out, T value, std::false_type /*signed*/) {
+	return write_unsigned(out, value);
+}
+
+template<typename T>
+std::size_t write_element(char* out, T value, std::streamsize) {
+	return write_integer(out, value, std::is_signed<T>{});
+}
+
+std::size_t write_character(char* out, char value) {
+	*out = value;
+	return 1;
+}
+
+std::size_t write_element(char* out, char value, std::streamsize) {return write_character(out, value);}
+std::size_t write_element(char* out, signed char value, std::streamsize) {return write_character(out, static_cast<char>(value));}
+std::size_t write_element(char* out, unsigned char value, std::streamsize) {return write_character(out, static_cast<char>(value));}
+
+std::size_t write_element(char* out, bool value, std::streamsize) {
+	*out = value ? '1' : '0';
+	return 1;
+}
+
+std::size_t write_element(char* out, double value, std::streamsize precision) {
+	return static_cast<std::size_t>(std::snprintf(out, max_element_size, "%.*g", static_cast<int>(precision), value));
+}
+
+std::size_t write_element(char* out, float value, std::streamsize precision) {
+	return write_element(out, static_cast<double>(value), precision);
+}
+
+std::size_t write_element(char* out, long double value, std::streamsize precision) {
+	return static_cast<std::size_t>(std::snprintf(out, max_element_size, "%.*Lg", static_cast<int>(precision), value));
+}
+
+// Narrows an integer back to a type of its original size, so that manipulators like std::hex
+// see the same type the caller passed:
+template<typename Short, typename Int, typename Long>
+void print_integer(std::ostream& stream, Long value, std::size_t size) {
+	if(size == sizeof(Short)) {
+		stream << static_cast<Short>(value);
+	} else if(size == sizeof(Int)) {
+		stream << static_cast<Int>(value);
+	} else {
+		stream << value;
+	}
+}
+
+void print_format_arg(std::ostream& stream, const format_arg& arg) {
+	switch(arg.type) {
+		case format_arg::kind::boolean:
+			stream << arg.value.boolean; break;
+		case format_arg::kind::character:
+			stream << arg.value.character; break;
+		case format_arg::kind::signed_integer:
+			print_integer<short, int>(stream, arg.value.signed_integer, arg.integer_size); break;
+		case format_arg::kind::unsigned_integer:
+			print_integer<unsigned short, unsigned>(stream, arg.value.unsigned_integer, arg.integer_size); break;
+		case format_arg::kind::floating:
+			stream << arg.value.floating; break;
+		case format_arg::kind::long_floating:
+			stream << arg.value.long_floating; break;
+		case format_arg::kind::c_string:
+			stream << arg.value.c_string; break;
+		case format_arg::kind::string:
+			stream << *arg.value.string; break;
+		case format_arg::kind::function:
+			arg.value.function.print(stream, arg.value.function.arg); break;
+		case format_arg::kind::generic:
+			arg.value.generic.print(stream, arg.value.generic.arg); break;
+		default:
+			#ifdef __GNUC__
+				__builtin_unreachable ();
+			#else
+				std::terminate();
+			#endif
+	}
+}
+
+std::tuple<std::string::const_iterator, bool> printFormatPartToStream(std::ostream& stream,
+		std::string::const_iterator begin, std::string::const_iterator end) {
+	if (begin == end) {
+		return std::make_tuple(end, false);
+	}
+	while (true) {
+		auto nextPercent = std::find(begin, end, '%');
+		stream.write(&*begin, nextPercent-begin);
+		if(nextPercent == end) {
+			return std::make_tuple(end, false);
+		} else {
+			begin = ++nextPercent;
+			if(begin == end) {
+				throw std::invalid_argument{"formatstrings must not end on unmatched '%'"};
+			} else if (*begin == '%') {
+				stream.put('%');
+				++begin;
+			} else if (*begin == 's') {
+				++begin;
+				return std::make_tuple(begin, true);
+			} else {
+				throw std::invalid_argument{"formatstring contains illegal format-specifier"};
+			}
+		}
+	}
+}
+
+} // anonymous namespace
+
+container_depth_guard::container_depth_guard() {
+	++container_depth;
+}
+
+container_depth_guard::~container_depth_guard() {
+	--container_depth;
+}
+
+bool container_depth_guard::exceeded() const {
+	return container_depth > settings::get_max_depth();
+}
+
+void print_elision(std::ostream& stream, bool first, std::size_t remaining) {
+	stream << (first ? "... (" : ", ... (");
+	if(remaining != unknown_remaining) {
+		stream << remaining << ' ';
+	}
+	stream << "more)";
+}
+
+template<typename T>
+void print_arithmetic_range(std::ostream& stream, const T* data, std::size_t size) {
+	const auto n = std::min(size, settings::get_max_elements());
+	stream.put('[');
+	if(has_default_format(stream)) {
+		const auto precision = stream.precision();
+		char buffer[4096];
+		std::size_t used = 0;
+		for(std::size_t i = 0; i < n; ++i) {
+			if(used > sizeof(buffer) - max_element_size - 2) {
+				stream.write(buffer, static_cast<std::streamsize>(used));
+				used = 0;
+			}
+			if(i > 0) {
+				buffer[used++] = ',';
+				buffer[used++] = ' ';
+			}
+			used += write_element(buffer + used, data[i], precision);
+		}
+		stream.write(buffer, static_cast<std::streamsize>(used));
+	} else {
+		for(std::size_t i = 0; i < n; ++i) {
+			if(i > 0) {
+				stream << ", ";
+			}
+			stream << data[i];
+		}
+	}
+	if(n < size) {
+		print_elision(stream, n == 0, size - n);
+	}
+	stream.put(']');
+}
+
+template void print_arithmetic_range(std::ostream&, const bool*, std::size_t);
+template void print_arithmetic_range(std::ostream&, const char*, std::size_t);
+template void print_arithmetic_range(std::ostream&, const signed char*, std::size_t);
+template void print_arithmetic_range(std::ostream&, const unsigned char*, std::size_t);
+template void print_arithmetic_range(std::ostream&, const short*, std::size_t);
+template void print_arithmetic_range(std::ostream&, const unsigned short*, std::size_t);
+template void print_arithmetic_range(std::ostream&, const int*, std::size_t);
+template void print_arithmetic_range(std::ostream&, const unsigned*, std::size_t);
+template void print_arithmetic_range(std::ostream&, const long*, std::size_t);
+template void print_arithmetic_range(std::ostream&, const unsigned long*, std::size_t);
+template void print_arithmetic_range(std::ostream&, const long long*, std::size_t);
+template void print_arithmetic_range(std::ostream&, const unsigned long long*, std::size_t);
+template void print_arithmetic_range(std::ostream&, const float*, std::size_t);
+template void print_arithmetic_range(std::ostream&, const double*, std::size_t);
+template void print_arithmetic_range(std::ostream&, const long double*, std::size_t);
+
+void print_format_args(std::ostream& stream, const format_arg* args, std::size_t n) {
+	std::for_each(args, args + n, [&](const format_arg& arg) {print_format_arg(stream, arg);});
+}
+
+void print_format_args_formated(std::ostream& stream, const std::string& format,
+		const format_arg* args, std::size_t n) {
+	auto it = format.begin();
+	const auto end = format.end();
+	bool print_argument;
+	for(std::size_t i = 0; i < n; ++i) {
+		std::tie(it, print_argument) = printFormatPartToStream(stream, it, end);
+		if(!print_argument) {
+			return;
+		}
+		print_format_arg(stream, args[i]);
+	}
+	std::tie(it, print_argument) = printFormatPartToStream(stream, it, end);
+	if (print_argument) {
+		throw std::invalid_argument{"formatstring requests more arguments then provided"};
+	}
+}
+
+std::string format_args_to_string(const format_arg* args, std::size_t n) {
+	std::stringstream stream;
+	print_format_args(stream, args, n);
+	return stream.str();
+}
+
+std::string format_args_formated(const std::string& format, const format_arg* args, std::size_t n) {
+	std::stringstream stream;
+	print_format_args_formated(stream, format, args, n);
+	return stream.str();
+}
+
+} // namespace impl
+
+} // namespace yoga
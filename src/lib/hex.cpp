@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <cstddef>
+#include <ostream>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define YOGA_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#include "../include/format.hpp"
+
+namespace yoga {
+
+namespace impl {
+
+namespace {
+
+const char hex_digits[] = "0123456789abcdef";
+
+// All kernels write exactly 2*size characters to out:
+
+std::size_t hex_encode_scalar(const unsigned char* data, std::size_t size, char* out) {
+	for(std::size_t i = 0; i < size; ++i) {
+		out[2 * i] = hex_digits[data[i] >> 4];
+		out[2 * i + 1] = hex_digits[data[i] & 0xf];
+	}
+	return size;
+}
+
+#ifdef YOGA_X86_SIMD
+
+// nibble + '0', plus the distance from '9'+1 to 'a' for nibbles above 9
+inline __m128i nibbles_to_ascii(__m128i nibbles) {
+	const auto above_nine = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+	const auto offset = _mm_and_si128(above_nine, _mm_set1_epi8('a' - '0' - 10));
+	return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), offset);
+}
+
+// Encodes 16 bytes at a time and returns how many bytes were encoded.
+std::size_t hex_encode_sse2(const unsigned char* data, std::size_t size, char* out) {
+	const auto low_mask = _mm_set1_epi8(0x0f);
+	std::size_t i = 0;
+	for(; i + 16 <= size; i += 16) {
+		const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+		const auto high = nibbles_to_ascii(_mm_and_si128(_mm_srli_epi16(bytes, 4), low_mask));
+		const auto low = nibbles_to_ascii(_mm_and_si128(bytes, low_mask));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_unpacklo_epi8(high, low));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i + 16), _mm_unpackhi_epi8(high, low));
+	}
+	return i;
+}
+
+__attribute__((target("avx2")))
+inline __m256i nibbles_to_ascii(__m256i nibbles) {
+	const auto above_nine = _mm256_cmpgt_epi8(nibbles, _mm256_set1_epi8(9));
+	const auto offset = _mm256_and_si256(above_nine, _mm256_set1_epi8('a' - '0' - 10));
+	return _mm256_add_epi8(_mm256_add_epi8(nibbles, _mm256_set1_epi8('0')), offset);
+}
+
+// Encodes 32 bytes at a time and returns how many bytes were encoded.
+__attribute__((target("avx2")))
+std::size_t hex_encode_avx2(const unsigned char* data, std::size_t size, char* out) {
+	const auto low_mask = _mm256_set1_epi8(0x0f);
+	std::size_t i = 0;
+	for(; i + 32 <= size; i += 32) {
+		const auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+		const auto high = nibbles_to_ascii(_mm256_and_si256(_mm256_srli_epi16(bytes, 4), low_mask));
+		const auto low = nibbles_to_ascii(_mm256_and_si256(bytes, low_mask));
+		// the unpack-instructions work on each 128-bit lane separately:
+		const auto first = _mm256_unpacklo_epi8(high, low);
+		const auto second = _mm256_unpackhi_epi8(high, low);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i),
+				_mm256_permute2x128_si256(first, second, 0x20));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i + 32),
+				_mm256_permute2x128_si256(first, second, 0x31));
+	}
+	return i;
+}
+
+bool has_avx2() {
+	static const bool result = __builtin_cpu_supports("avx2");
+	return result;
+}
+
+#endif
+
+void hex_encode(const unsigned char* data, std::size_t size, char* out) {
+	std::size_t done = 0;
+#ifdef YOGA_X86_SIMD
+	if(has_avx2()) {
+		done += hex_encode_avx2(data, size, out);
+	}
+	done += hex_encode_sse2(data + done, size - done, out + 2 * done);
+#endif
+	hex_encode_scalar(data + done, size - done, out + 2 * done);
+}
+
+constexpr std::size_t bytes_per_line = 16;
+
+// “00000010  48 65 6c 6c 6f 2c 20 77  6f 72 6c 64 21 0a 00 01  |Hello, world!...|”
+std::size_t write_hexdump_line(const unsigned char* data, std::size_t size, std::size_t offset,
+		char* out) {
+	char hex[2 * bytes_per_line];
+	hex_encode(data, size, hex);
+	char* it = out;
+	for(int shift = 28; shift >= 0; shift -= 4) {
+		*it++ = hex_digits[(offset >> shift) & 0xf];
+	}
+	*it++ = ' ';
+	for(std::size_t i = 0; i < bytes_per_line; ++i) {
+		*it++ = ' ';
+		if(i == bytes_per_line / 2) {
+			*it++ = ' ';
+		}
+		if(i < size) {
+			*it++ = hex[2 * i];
+			*it++ = hex[2 * i + 1];
+		} else {
+			*it++ = ' ';
+			*it++ = ' ';
+		}
+	}
+	*it++ = ' ';
+	*it++ = ' ';
+	*it++ = '|';
+	it = std::transform(data, data + size, it, [](unsigned char c) {
+		return c >= 0x20 && c < 0x7f ? static_cast<char>(c) : '.';
+	});
+	*it++ = '|';
+	return static_cast<std::size_t>(it - out);
+}
+
+} // anonymous namespace
+
+void print_hex(std::ostream& stream, const unsigned char* data, std::size_t size) {
+	constexpr std::size_t chunk_size = 2048;
+	char buffer[2 * chunk_size];
+	for(std::size_t i = 0; i < size; i += chunk_size) {
+		const auto n = std::min(chunk_size, size - i);
+		hex_encode(data + i, n, buffer);
+		stream.write(buffer, static_cast<std::streamsize>(2 * n));
+	}
+}
+
+void print_hexdump(std::ostream& stream, const unsigned char* data, std::size_t size) {
+	constexpr std::size_t max_line_size = 80;
+	char buffer[64 * max_line_size];
+	std::size_t used = 0;
+	for(std::size_t offset = 0; offset < size; offset += bytes_per_line) {
+		if(used > sizeof(buffer) - max_line_size) {
+			stream.write(buffer, static_cast<std::streamsize>(used));
+			used = 0;
+		}
+		if(offset > 0) {
+			buffer[used++] = '\n';
+		}
+		used += write_hexdump_line(data + offset, std::min(bytes_per_line, size - offset),
+				offset, buffer + used);
+	}
+	stream.write(buffer, static_cast<std::streamsize>(used));
+}
+
+} // namespace impl
+
+} // namespace yoga
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#include "../include/logfile.hpp"
+
+namespace yoga {
+
+namespace {
+
+using time_point = std::chrono::time_point<std::chrono::system_clock>;
+
+// The offset of the last indexed record that only has earlier records before it, or 0:
+std::uint64_t find_start_offset(const std::string& filename, std::int64_t begin) {
+	std::ifstream index{filename + ".idx", std::ios_base::in | std::ios_base::binary | std::ios_base::ate};
+	if(!index.is_open()) {
+		return 0;
+	}
+	const auto entry_size = static_cast<std::streamoff>(sizeof(impl::logfile_index_entry));
+	std::streamoff low = 0;
+	std::streamoff high = static_cast<std::streamoff>(index.tellg()) / entry_size;
+	std::uint64_t offset = 0;
+	// max_time is monotonic, so find the last entry with max_time < begin:
+	while(low < high) {
+		const auto mid = low + (high - low) / 2;
+		impl::logfile_index_entry entry;
+		index.seekg(mid * entry_size);
+		if(!index.read(reinterpret_cast<char*>(&entry), sizeof(entry))) {
+			return 0;
+		}
+		if(entry.max_time < begin) {
+			offset = entry.offset;
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return offset;
+}
+
+priority parse_priority(const std::string& label) {
+	if(label == "[Fatal]") {
+		return priority::fatal;
+	} else if(label == "[Error]") {
+		return priority::error;
+	} else if(label == "[Warn ]") {
+		return priority::warn;
+	} else if(label == "[Info ]") {
+		return priority::info;
+	} else if(label == "[Debug]") {
+		return priority::debug;
+	} else if(label == "[Trace]") {
+		return priority::trace;
+	}
+	throw std::invalid_argument{"invalid priority-label"};
+}
+
+} // anonymous namespace
+
+void read_logfile(const std::string& filename, const time_point& begin, const time_point& end,
+		priority min_priority, const std::function<void(const log_record&)>& callback) {
+	std::ifstream file{filename, std::ios_base::in | std::ios_base::binary};
+	if(!file.is_open()) {
+		throw std::runtime_error{"could not open logfile “" + filename + "”"};
+	}
+	const auto begin_time = begin.time_since_epoch().count();
+	const auto end_time = end.time_since_epoch().count();
+	const auto stop_time = (end + impl::max_disorder).time_since_epoch().count();
+	file.seekg(static_cast<std::streamoff>(find_start_offset(filename, begin_time)));
+	
+	log_record record;
+	std::int64_t record_time = 0;
+	bool in_record = false;
+	const auto emit = [&] {
+		if(in_record && record_time >= begin_time && record_time < end_time
+				&& record.prio >= min_priority) {
+			callback(record);
+		}
+	};
+	std::string line;
+	while(std::getline(file, line)) {
+		std::int64_t time;
+		priority p;
+		if(impl::parse_logline_header(line, time, p)) {
+			emit();
+			if(time >= stop_time) {
+				return;
+			}
+			record.time = time_point{time_point::duration{time}};
+			record.prio = p;
+			record.text = std::move(line);
+			record_time = time;
+			in_record = true;
+		} else if(in_record) {
+			// messages may contain newlines:
+			record.text += '\n';
+			record.text += line;
+		}
+	}
+	emit();
+}
+
+namespace impl {
+
+bool parse_logline_header(const std::string& line, std::int64_t& time, priority& p) {
+	// “[1234] [Info ]”
+	if(line.size() < 2 || line[0] != '[') {
+		return false;
+	}
+	const auto close = line.find(']', 1);
+	const auto digits_begin = line[1] == '-' ? 2u : 1u;
+	if(close == std::string::npos || close <= digits_begin || line.size() < close + 9
+			|| line[close + 1] != ' ' || !std::all_of(line.begin() + digits_begin,
+				line.begin() + static_cast<std::ptrdiff_t>(close), [](char c) {return c >= '0' && c <= '9';})) {
+		return false;
+	}
+	try {
+		p = parse_priority(line.substr(close + 2, 7));
+		time = std::stoll(line.substr(1, close - 1));
+	} catch(std::logic_error&) {
+		return false;
+	}
+	return true;
+}
+
+bool index_entry_matches(const std::string& filename, const logfile_index_entry& entry) {
+	std::ifstream file{filename, std::ios_base::in | std::ios_base::binary};
+	// the entry has to point to the start of a record:
+	if(entry.offset > 0) {
+		file.seekg(static_cast<std::streamoff>(entry.offset - 1));
+		if(file.get() != '\n') {
+			return false;
+		}
+	}
+	std::string line;
+	std::int64_t time;
+	priority p;
+	if(!std::getline(file, line) || !parse_logline_header(line, time, p)) {
+		return false;
+	}
+	if(entry.max_time == std::numeric_limits<std::int64_t>::min()) {
+		return true;
+	}
+	// max_time may be an estimate that is already max_disorder too late, and the record itself
+	// may be max_disorder older than the ones before it:
+	const auto disorder = std::chrono::duration_cast<std::chrono::system_clock::duration>(
+			max_disorder).count();
+	return time >= entry.max_time - 2 * disorder;
+}
+
+std::int64_t estimate_max_time(const std::string& filename, std::uint64_t size) {
+	std::ifstream file{filename, std::ios_base::in | std::ios_base::binary};
+	// read backwards from the end until a chunk contains the start of a record:
+	for(std::uint64_t chunk_size = 1 << 16;; chunk_size *= 2) {
+		const auto start = size > chunk_size ? size - chunk_size : 0;
+		std::string chunk(static_cast<std::size_t>(size - start), '\0');
+		file.clear();
+		file.seekg(static_cast<std::streamoff>(start));
+		if(!file.read(&chunk[0], static_cast<std::streamsize>(chunk.size()))) {
+			return std::numeric_limits<std::int64_t>::min();
+		}
+		// the first line is only complete at the start of the file:
+		auto line_begin = start == 0 ? 0 : chunk.find('\n');
+		if(start != 0 && line_begin != std::string::npos) {
+			++line_begin;
+		}
+		bool found = false;
+		std::int64_t max_time = std::numeric_limits<std::int64_t>::min();
+		while(line_begin < chunk.size()) {
+			const auto line_end = std::min(chunk.find('\n', line_begin), chunk.size());
+			std::int64_t time;
+			priority p;
+			if(parse_logline_header(chunk.substr(line_begin, line_end - line_begin), time, p)) {
+				max_time = std::max(max_time, time);
+				found = true;
+			}
+			line_begin = line_end + 1;
+		}
+		if(found) {
+			const auto disorder = std::chrono::duration_cast<std::chrono::system_clock::duration>(
+					max_disorder).count();
+			return max_time > std::numeric_limits<std::int64_t>::max() - disorder
+				? std::numeric_limits<std::int64_t>::max()
+				: max_time + disorder;
+		}
+		if(start == 0) {
+			return std::numeric_limits<std::int64_t>::min();
+		}
+	}
+}
+
+} // namespace impl
+
+} // namespace yoga
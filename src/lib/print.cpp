@@ -1,14 +1,107 @@
 #include <atomic>
+#include <cerrno>
 #include <chrono>
+#include <cstring>
 #include <ctime>
 #include <fstream>
 #include <iomanip>
 #include <ios>
+#include <limits>
+#include <streambuf>
+#include <vector>
 
+#include <unistd.h>
+
+#include "../include/logfile.hpp"
 #include "../include/print.hpp"
 
 namespace yoga {
 
+namespace {
+
+// A streambuf that writes its content to a filedescriptor without any further buffering
+// or synchronization:
+class fd_streambuf: public std::streambuf {
+public:
+	fd_streambuf(int fd, std::size_t size): fd{fd}, buffer(size) {
+		setp(buffer.data(), buffer.data() + buffer.size());
+	}
+	
+	~fd_streambuf() {
+		sync();
+	}
+	
+protected:
+	int_type overflow(int_type c) override {
+		if(!flush_buffer()) {
+			return traits_type::eof();
+		}
+		if(!traits_type::eq_int_type(c, traits_type::eof())) {
+			*pptr() = traits_type::to_char_type(c);
+			pbump(1);
+		}
+		return traits_type::not_eof(c);
+	}
+	
+	std::streamsize xsputn(const char* str, std::streamsize n) override {
+		if(n > epptr() - pptr()) {
+			if(!flush_buffer()) {
+				return 0;
+			}
+			if(n >= epptr() - pptr()) {
+				return write_all(str, static_cast<std::size_t>(n)) ? n : 0;
+			}
+		}
+		std::memcpy(pptr(), str, static_cast<std::size_t>(n));
+		pbump(static_cast<int>(n));
+		return n;
+	}
+	
+	int sync() override {
+		return flush_buffer() ? 0 : -1;
+	}
+	
+private:
+	bool flush_buffer() {
+		const auto success = write_all(pbase(), static_cast<std::size_t>(pptr() - pbase()));
+		setp(buffer.data(), buffer.data() + buffer.size());
+		return success;
+	}
+	
+	bool write_all(const char* data, std::size_t size) {
+		while(size > 0) {
+			const auto written = ::write(fd, data, size);
+			if(written < 0) {
+				if(errno == EINTR) {
+					continue;
+				}
+				return false;
+			}
+			data += written;
+			size -= static_cast<std::size_t>(written);
+		}
+		return true;
+	}
+	
+	const int fd;
+	std::vector<char> buffer;
+};
+
+constexpr std::size_t stdout_buffer_size = 1 << 16;
+
+fd_streambuf stdout_buffer{STDOUT_FILENO, stdout_buffer_size};
+std::ostream buffered_stdout{&stdout_buffer};
+bool use_buffered_stdout = false;
+
+// Destroyed before the buffer; later writes will go to std::cout again:
+struct stdout_buffer_guard {
+	~stdout_buffer_guard() {
+		use_buffered_stdout = false;
+		buffered_stdout.flush();
+	}
+} stdout_guard;
+
+} // anonymous namespace
 
 namespace settings {
 
@@ -20,6 +113,43 @@ std::ofstream logfile;
 
 std::atomic_bool logfile_is_open{false};
 std::mutex logfile_mutex;
+
+std::size_t logindex_interval_kib = 0;
+std::ofstream logindex;
+std::uint64_t logfile_offset = 0;
+std::uint64_t next_logindex_offset = 0;
+std::int64_t max_logged_time = std::numeric_limits<std::int64_t>::min();
+
+// Continues an existing index if it matches the logfile and starts a new one otherwise.
+void open_logindex(const std::string& filename) {
+	logfile.seekp(0, std::ios_base::end);
+	logfile_offset = static_cast<std::uint64_t>(logfile.tellp());
+	const auto index_name = filename + ".idx";
+	
+	impl::logfile_index_entry last{std::numeric_limits<std::int64_t>::min(), 0};
+	bool continue_index = false;
+	{
+		std::ifstream index{index_name, std::ios_base::in | std::ios_base::binary | std::ios_base::ate};
+		const auto size = index.is_open() ? static_cast<std::streamoff>(index.tellg()) : 0;
+		const auto entry_size = static_cast<std::streamoff>(sizeof(last));
+		if(size >= entry_size && size % entry_size == 0) {
+			index.seekg(size - entry_size);
+			continue_index = index.read(reinterpret_cast<char*>(&last), sizeof(last))
+				&& last.offset <= logfile_offset && impl::index_entry_matches(filename, last);
+		}
+	}
+	if(!continue_index) {
+		last = {std::numeric_limits<std::int64_t>::min(), 0};
+	}
+	// the index-entries need the latest time of all records before them; scanning the
+	// whole file would block the loggers, so only the last records are considered:
+	max_logged_time = logfile_offset > last.offset
+		? std::max(last.max_time, impl::estimate_max_time(filename, logfile_offset))
+		: last.max_time;
+	next_logindex_offset = continue_index ? last.offset + logindex_interval_kib * 1024 : logfile_offset;
+	logindex.open(index_name, std::ios_base::out | std::ios_base::binary
+			| (continue_index ? std::ios_base::app : std::ios_base::trunc));
+}
 }
 
 priority get_priority() {return minimum_priority;}
@@ -36,15 +166,44 @@ void set_logfile(const std::string& filename) {
 	if(logfile.is_open()) {
 		logfile.close();
 	}
-	if(filename.empty()) {
+	if(logindex.is_open()) {
+		logindex.close();
+	}
+	if(!filename.empty()) {
 		logfile.open(filename, std::ios_base::out | std::ios_base::app);
 		logfile_is_open = logfile.is_open();
+		if(logfile_is_open && logindex_interval_kib > 0) {
+			open_logindex(filename);
+		}
 	} else {
 		logfile_is_open = false;
 	}
 }
+
+void set_logfile_index(std::size_t interval_kib) {
+	std::lock_guard<std::mutex> guard{logfile_mutex};
+	logindex_interval_kib = interval_kib;
+}
+std::size_t get_logfile_index() {return logindex_interval_kib;}
+
+void set_buffered_stdout(bool b) {
+	if(use_buffered_stdout == b) {
+		return;
+	}
+	if(b) {
+		std::cout.flush();
+	} else {
+		buffered_stdout.flush();
+	}
+	use_buffered_stdout = b;
+}
+bool get_buffered_stdout() {return use_buffered_stdout;}
 } // namespace settings
 
+void flush() {
+	impl::get_stdout().flush();
+}
+
 void print_priority(std::ostream& stream, priority p) {
 	switch(p) {
 		case priority::fatal:
@@ -147,8 +306,39 @@ static void log_to_file(const location& loc, priority p,
 	if(!settings::logfile_is_open) {
 		return;
 	}
+	const auto line = impl::format_logline(loc, p, timePoint, msg);
+	{
+		std::lock_guard<std::mutex> guard{settings::logfile_mutex};
+		if(!settings::logfile_is_open) {
+			return;
+		}
+		if(settings::logindex.is_open()) {
+			if(settings::logfile_offset >= settings::next_logindex_offset) {
+				const impl::logfile_index_entry entry{settings::max_logged_time, settings::logfile_offset};
+				settings::logindex.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+				settings::logindex.flush();
+				settings::next_logindex_offset =
+					settings::logfile_offset + settings::logindex_interval_kib * 1024;
+			}
+			settings::logfile_offset += line.size();
+			settings::max_logged_time = std::max<std::int64_t>(settings::max_logged_time,
+					timePoint.time_since_epoch().count());
+		}
+		settings::logfile << line << std::flush;
+	}
+}
+
+namespace impl {
+
+std::ostream& get_stdout() {
+	return use_buffered_stdout ? buffered_stdout : std::cout;
+}
+
+std::string format_logline(const location& loc, priority p,
+		const std::chrono::time_point<std::chrono::system_clock>& time_point,
+		const std::string& msg) {
 	std::stringstream stream;
-	print_time(stream, timePoint);
+	print_time(stream, time_point);
 	stream << ' ';
 	print_priority(stream, p);
 	
@@ -158,22 +348,15 @@ static void log_to_file(const location& loc, priority p,
 	}
 	
 	stream << ": " << msg << '\n';
-	{
-		std::lock_guard<std::mutex> guard{settings::logfile_mutex};
-		if(!settings::logfile_is_open) {
-			return;
-		}
-		settings::logfile << stream.str() << std::flush;
-	}
+	return stream.str();
 }
 
-namespace impl {
-
 void log(const location& loc, priority p, const std::string msg) {
 	auto time =std::chrono::system_clock::now();
 	
 	log_to_terminal(loc, p, time, msg);
 	log_to_file(loc, p, time, msg);
+	log_to_socket(loc, p, time, msg);
 }
 
 } // namespace impl
@@ -0,0 +1,464 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../include/print.hpp"
+
+namespace yoga {
+
+namespace {
+
+constexpr std::size_t max_queued_records = 1 << 14;
+constexpr std::size_t max_batch_size = 64;
+constexpr auto min_reconnect_delay = std::chrono::milliseconds{50};
+constexpr auto max_reconnect_delay = std::chrono::seconds{5};
+// how long closing the sink may try to deliver the remaining records:
+constexpr auto max_close_delay = std::chrono::seconds{1};
+
+// severity as defined by RFC 5424, section 6.2.1
+int get_severity(priority p) {
+	switch(p) {
+		case priority::fatal:
+			return 2; // critical
+		case priority::error:
+			return 3;
+		case priority::warn:
+			return 4;
+		case priority::info:
+			return 6;
+		case priority::debug:
+		case priority::trace:
+			return 7;
+		default:
+			#ifdef __GNUC__
+				__builtin_unreachable ();
+			#else
+				std::terminate();
+			#endif
+	}
+}
+
+// HOSTNAME and APP-NAME may only contain printable US-ASCII without spaces (RFC 5424, section 6.2):
+std::string to_header_field(const char* value, std::size_t max_length) {
+	std::string result;
+	for(; *value && result.size() < max_length; ++value) {
+		const auto c = *value;
+		result.push_back(c > ' ' && c < 0x7f ? c : '_');
+	}
+	return result.empty() ? "-" : result;
+}
+
+const std::string& get_hostname() {
+	static const std::string hostname = [] {
+		char buffer[HOST_NAME_MAX + 1] = {};
+		if(::gethostname(buffer, sizeof(buffer) - 1) != 0) {
+			return std::string{"-"};
+		}
+		return to_header_field(buffer, 255);
+	}();
+	return hostname;
+}
+
+const std::string& get_appname() {
+	static const std::string appname = [] {
+		#ifdef __GLIBC__
+			return to_header_field(program_invocation_short_name, 48);
+		#else
+			return std::string{"-"};
+		#endif
+	}();
+	return appname;
+}
+
+// Quotes, backslashes and closing brackets have to be escaped in PARAM-VALUEs (RFC 5424, section 6.3.3)
+void print_param_value(std::ostream& stream, const char* value) {
+	for(; *value; ++value) {
+		if(*value == '"' || *value == '\\' || *value == ']') {
+			stream.put('\\');
+		}
+		stream.put(*value);
+	}
+}
+
+std::string format_rfc5424(const location& loc, priority p,
+		const std::chrono::time_point<std::chrono::system_clock>& time_point,
+		const std::string& msg) {
+	constexpr int facility_user = 1;
+	const auto since_epoch = time_point.time_since_epoch();
+	const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+	const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(since_epoch - seconds);
+	const std::time_t time = seconds.count();
+	std::tm utc;
+	::gmtime_r(&time, &utc);
+	char timestamp[40];
+	std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", &utc);
+	
+	std::stringstream stream;
+	stream << '<' << facility_user * 8 + get_severity(p) << ">1 " << timestamp << '.'
+		<< std::setw(6) << std::setfill('0') << micros.count() << std::setw(0) << "Z "
+		<< get_hostname() << ' ' << get_appname() << ' ' << ::getpid() << " - ";
+	if(settings::get_print_location()) {
+		stream << "[location@32473 file=\"";
+		print_param_value(stream, loc.file);
+		stream << "\" line=\"" << loc.line << "\"] ";
+	} else {
+		stream << "- ";
+	}
+	stream << msg;
+	return stream.str();
+}
+
+class socket_sink {
+public:
+	~socket_sink() {
+		close();
+	}
+	
+	void open(const std::string& path, settings::socket_framing framing) {
+		close();
+		if(path.empty()) {
+			return;
+		}
+		if(::pipe2(wakeup_fds, O_CLOEXEC | O_NONBLOCK) != 0) {
+			return;
+		}
+		std::lock_guard<std::mutex> guard{mutex};
+		this->path = path;
+		this->framing = framing;
+		stop = false;
+		stopping = false;
+		dropped = 0;
+		total_dropped = 0;
+		worker = std::thread{[this]{run();}};
+		enabled = true;
+	}
+	
+	void close() {
+		enabled = false;
+		{
+			std::lock_guard<std::mutex> guard{mutex};
+			stop = true;
+		}
+		cv.notify_all();
+		if(worker.joinable()) {
+			// the worker may be waiting for the socket to become writable:
+			const char wakeup = 0;
+			while(::write(wakeup_fds[1], &wakeup, 1) < 0 && errno == EINTR) {}
+			worker.join();
+		}
+		for(auto& wakeup_fd: wakeup_fds) {
+			if(wakeup_fd >= 0) {
+				::close(wakeup_fd);
+				wakeup_fd = -1;
+			}
+		}
+	}
+	
+	void push(const location& loc, priority p,
+			const std::chrono::time_point<std::chrono::system_clock>& time_point,
+			const std::string& msg) {
+		auto record = framing == settings::socket_framing::rfc5424
+			? format_rfc5424(loc, p, time_point, msg)
+			: impl::format_logline(loc, p, time_point, msg);
+		{
+			std::lock_guard<std::mutex> guard{mutex};
+			if(queue.size() + pending_size >= max_queued_records) {
+				++dropped;
+				++total_dropped;
+				return;
+			}
+			queue.push_back(std::move(record));
+		}
+		cv.notify_one();
+	}
+	
+	std::atomic_bool enabled{false};
+	std::atomic<std::size_t> total_dropped{0};
+	
+private:
+	void run() {
+		std::vector<std::string> pending;
+		auto reconnect_delay = std::chrono::steady_clock::duration{min_reconnect_delay};
+		while(true) {
+			{
+				std::unique_lock<std::mutex> lock{mutex};
+				cv.wait(lock, [&]{return stop || !queue.empty() || !pending.empty();});
+				update_stopping();
+			}
+			if(stopping && std::chrono::steady_clock::now() >= give_up_time) {
+				break;
+			}
+			if(fd < 0 && !connect()) {
+				if(stopping) {
+					break;
+				}
+				std::unique_lock<std::mutex> lock{mutex};
+				cv.wait_for(lock, reconnect_delay, [&]{return stop;});
+				reconnect_delay = std::min<std::chrono::steady_clock::duration>(
+						reconnect_delay * 2, max_reconnect_delay);
+				continue;
+			}
+			reconnect_delay = min_reconnect_delay;
+			// the queue is only drained while connected, so that push() keeps dropping
+			// records while the collector is unavailable:
+			{
+				std::lock_guard<std::mutex> guard{mutex};
+				std::move(queue.begin(), queue.end(), std::back_inserter(pending));
+				queue.clear();
+				if(dropped > 0) {
+					pending.push_back(frame("yoga: dropped " + std::to_string(dropped)
+							+ " records while the socket was unavailable"));
+					dropped = 0;
+				}
+				pending_size = pending.size();
+			}
+			send(pending);
+			{
+				std::lock_guard<std::mutex> guard{mutex};
+				pending_size = pending.size();
+			}
+			if(stopping && pending.empty()) {
+				break;
+			}
+		}
+		// everything that couldn't be delivered in time is lost:
+		{
+			std::lock_guard<std::mutex> guard{mutex};
+			total_dropped += pending.size() + queue.size();
+			queue.clear();
+			pending_size = 0;
+		}
+		disconnect();
+	}
+	
+	// Must be called with the mutex locked.
+	void update_stopping() {
+		if(stop && !stopping) {
+			stopping = true;
+			give_up_time = std::chrono::steady_clock::now() + max_close_delay;
+		}
+	}
+	
+	// Waits until the socket is writable; returns false once the sink is closed and the
+	// records could not be delivered in time.
+	bool wait_writable() {
+		pollfd fds[2] = {{fd, POLLOUT, 0}, {wakeup_fds[0], POLLIN, 0}};
+		while(true) {
+			int timeout = -1;
+			if(stopping) {
+				const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+						give_up_time - std::chrono::steady_clock::now()).count();
+				if(remaining <= 0) {
+					return false;
+				}
+				timeout = static_cast<int>(remaining);
+			}
+			const auto result = ::poll(fds, 2, timeout);
+			if(result < 0 && errno != EINTR) {
+				return false;
+			}
+			if(result > 0 && fds[0].revents != 0) {
+				return true;
+			}
+			if(result > 0 && fds[1].revents != 0) {
+				char buffer[16];
+				while(::read(wakeup_fds[0], buffer, sizeof(buffer)) > 0) {}
+				std::lock_guard<std::mutex> guard{mutex};
+				update_stopping();
+			}
+		}
+	}
+	
+	std::string frame(const std::string& msg) const {
+		return framing == settings::socket_framing::rfc5424 ? "<13>1 - - - - - - " + msg : msg + '\n';
+	}
+	
+	bool connect() {
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		if(path.size() >= sizeof(address.sun_path)) {
+			return false;
+		}
+		std::copy(path.begin(), path.end(), address.sun_path);
+		for(auto type: {SOCK_DGRAM, SOCK_STREAM}) {
+			fd = ::socket(AF_UNIX, type | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+			if(fd < 0) {
+				return false;
+			}
+			if(::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+				is_stream = type == SOCK_STREAM;
+				return true;
+			}
+			const auto error = errno;
+			disconnect();
+			if(error != EPROTOTYPE) {
+				return false;
+			}
+		}
+		return false;
+	}
+	
+	void disconnect() {
+		if(fd >= 0) {
+			::close(fd);
+			fd = -1;
+		}
+	}
+	
+	// Sends as many of the records as possible and removes them; disconnects on failure.
+	void send(std::vector<std::string>& records) {
+		std::size_t sent = 0;
+		while(sent < records.size()) {
+			const auto batch = std::min(max_batch_size, records.size() - sent);
+			const auto result = is_stream
+				? send_stream(records.data() + sent, batch)
+				: send_datagrams(records.data() + sent, batch);
+			if(result < 0) {
+				disconnect();
+				break;
+			}
+			sent += static_cast<std::size_t>(result);
+		}
+		records.erase(records.begin(), records.begin() + static_cast<std::ptrdiff_t>(sent));
+	}
+	
+	ssize_t send_datagrams(std::string* records, std::size_t n) {
+		iovec iovecs[max_batch_size];
+		mmsghdr messages[max_batch_size] = {};
+		for(std::size_t i = 0; i < n; ++i) {
+			iovecs[i] = {&records[i][0], records[i].size()};
+			messages[i].msg_hdr.msg_iov = &iovecs[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+		}
+		while(true) {
+			const auto result = ::sendmmsg(fd, messages, static_cast<unsigned>(n), MSG_NOSIGNAL);
+			if(result < 0 && errno == EINTR) {
+				continue;
+			}
+			if(result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+				if(!wait_writable()) {
+					return -1;
+				}
+				continue;
+			}
+			if(result < 0 && errno == EMSGSIZE) {
+				// this record will never fit into a datagram, so drop it:
+				return 1;
+			}
+			return result;
+		}
+	}
+	
+	ssize_t send_stream(std::string* records, std::size_t n) {
+		// octet-counting-framing requires a length-prefix for every record:
+		std::string prefixes[max_batch_size];
+		iovec iovecs[2 * max_batch_size];
+		std::size_t count = 0;
+		std::size_t total = 0;
+		for(std::size_t i = 0; i < n; ++i) {
+			if(framing == settings::socket_framing::rfc5424) {
+				prefixes[i] = std::to_string(records[i].size()) + ' ';
+				iovecs[count++] = {&prefixes[i][0], prefixes[i].size()};
+				total += prefixes[i].size();
+			}
+			iovecs[count++] = {&records[i][0], records[i].size()};
+			total += records[i].size();
+		}
+		// sendmsg is writev that doesn't raise SIGPIPE:
+		msghdr message{};
+		message.msg_iov = iovecs;
+		message.msg_iovlen = count;
+		while(total > 0) {
+			const auto written = ::sendmsg(fd, &message, MSG_NOSIGNAL);
+			if(written < 0) {
+				if(errno == EINTR) {
+					continue;
+				}
+				if((errno == EAGAIN || errno == EWOULDBLOCK) && wait_writable()) {
+					continue;
+				}
+				return -1;
+			}
+			total -= static_cast<std::size_t>(written);
+			auto remaining = static_cast<std::size_t>(written);
+			while(remaining > 0 && remaining >= message.msg_iov->iov_len) {
+				remaining -= message.msg_iov->iov_len;
+				++message.msg_iov;
+				--message.msg_iovlen;
+			}
+			if(remaining > 0) {
+				message.msg_iov->iov_base = static_cast<char*>(message.msg_iov->iov_base) + remaining;
+				message.msg_iov->iov_len -= remaining;
+			}
+		}
+		return static_cast<ssize_t>(n);
+	}
+	
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::vector<std::string> queue;
+	std::size_t pending_size = 0; // the records that the worker took from the queue
+	std::size_t dropped = 0;
+	bool stop = false;
+	
+	std::thread worker;
+	int wakeup_fds[2] = {-1, -1};
+	bool stopping = false;
+	std::chrono::steady_clock::time_point give_up_time;
+	std::string path;
+	std::atomic<settings::socket_framing> framing{settings::socket_framing::rfc5424};
+	int fd = -1;
+	bool is_stream = false;
+};
+
+socket_sink& get_sink() {
+	static socket_sink sink;
+	return sink;
+}
+
+} // anonymous namespace
+
+namespace settings {
+
+void set_logsocket(const std::string& path, socket_framing framing) {
+	get_sink().open(path, framing);
+}
+
+std::size_t get_logsocket_dropped() {
+	return get_sink().total_dropped;
+}
+
+} // namespace settings
+
+namespace impl {
+
+void log_to_socket(const location& loc, priority p,
+		const std::chrono::time_point<std::chrono::system_clock>& time_point,
+		const std::string& msg) {
+	auto& sink = get_sink();
+	if(sink.enabled) {
+		sink.push(loc, p, time_point, msg);
+	}
+}
+
+} // namespace impl
+
+} // namespace yoga
@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../include/trace.hpp"
+
+namespace yoga {
+
+namespace {
+
+enum class event_kind {
+	complete,
+	instant
+};
+
+struct trace_event {
+	const char* file;
+	const char* function;
+	int line;
+	event_kind kind;
+	unsigned depth;
+	std::int64_t begin;
+	std::int64_t end;
+};
+
+std::int64_t now() {
+	static const auto epoch = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - epoch).count();
+}
+
+class thread_buffer;
+
+// The sink that all thread-buffers are flushed into. It knows all live buffers, so that
+// closing the tracefile doesn't lose the events that other threads haven't flushed yet.
+// Locks are always taken in the order buffers_mutex, buffer-lock, mutex.
+class trace_sink {
+public:
+	~trace_sink() {
+		std::lock_guard<std::mutex> buffers_guard{buffers_mutex};
+		flush_buffers();
+		std::lock_guard<std::mutex> guard{mutex};
+		close();
+	}
+	
+	void open(const std::string& filename) {
+		std::lock_guard<std::mutex> buffers_guard{buffers_mutex};
+		flush_buffers();
+		std::lock_guard<std::mutex> guard{mutex};
+		close();
+		if(filename.empty()) {
+			return;
+		}
+		file.open(filename, std::ios_base::out | std::ios_base::trunc);
+		if(file.is_open()) {
+			file << "{\"traceEvents\":[";
+			first_event = true;
+			enabled = true;
+		}
+	}
+	
+	void write(const std::vector<trace_event>& events, unsigned tid) {
+		std::lock_guard<std::mutex> guard{mutex};
+		if(!file.is_open()) {
+			return;
+		}
+		const auto pid = ::getpid();
+		for(const auto& event: events) {
+			file << (first_event ? "\n" : ",\n");
+			first_event = false;
+			file << "{\"name\":";
+			write_string(event.function);
+			file << ",\"cat\":\"yoga\",\"ph\":";
+			if(event.kind == event_kind::complete) {
+				file << "\"X\",\"ts\":";
+				write_microseconds(event.begin);
+				file << ",\"dur\":";
+				write_microseconds(event.end - event.begin);
+			} else {
+				file << "\"i\",\"s\":\"t\",\"ts\":";
+				write_microseconds(event.begin);
+			}
+			file << ",\"pid\":" << pid << ",\"tid\":" << tid << ",\"args\":{\"file\":";
+			write_string(event.file);
+			file << ",\"line\":" << event.line << ",\"depth\":" << event.depth << "}}";
+		}
+		file.flush();
+	}
+	
+	void add_buffer(thread_buffer* buffer) {
+		std::lock_guard<std::mutex> guard{buffers_mutex};
+		buffers.push_back(buffer);
+	}
+	
+	void remove_buffer(thread_buffer* buffer) {
+		std::lock_guard<std::mutex> guard{buffers_mutex};
+		buffers.erase(std::find(buffers.begin(), buffers.end(), buffer));
+	}
+	
+	std::atomic_bool enabled{false};
+	
+private:
+	// requires buffers_mutex:
+	void flush_buffers();
+	
+	void close() {
+		enabled = false;
+		if(file.is_open()) {
+			file << "\n]}\n";
+			file.close();
+		}
+	}
+	
+	void write_microseconds(std::int64_t ns) {
+		const char digits[] = {
+			char('0' + ns / 100 % 10), char('0' + ns / 10 % 10), char('0' + ns % 10)};
+		file << ns / 1000 << '.';
+		file.write(digits, sizeof(digits));
+	}
+	
+	void write_string(const char* str) {
+		file.put('"');
+		for(; *str; ++str) {
+			const auto c = *str;
+			if(c == '"' || c == '\\') {
+				file.put('\\');
+				file.put(c);
+			} else if(static_cast<unsigned char>(c) < 0x20) {
+				const char hex[] = "0123456789abcdef";
+				file << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+			} else {
+				file.put(c);
+			}
+		}
+		file.put('"');
+	}
+	
+	std::ofstream file;
+	std::mutex mutex;
+	bool first_event = true;
+	std::vector<thread_buffer*> buffers;
+	std::mutex buffers_mutex;
+};
+
+trace_sink& get_sink() {
+	static trace_sink sink;
+	return sink;
+}
+
+// Every thread collects its events locally and only touches the sink once the buffer is full.
+// The lock is only contended while the sink drains the buffer from another thread:
+class thread_buffer {
+public:
+	thread_buffer(): tid{next_tid++} {
+		events.reserve(capacity);
+		get_sink().add_buffer(this);
+	}
+	
+	~thread_buffer() {
+		flush();
+		get_sink().remove_buffer(this);
+	}
+	
+	void push(const trace_event& event) {
+		std::lock_guard<std::mutex> guard{mutex};
+		events.push_back(event);
+		if(events.size() >= capacity) {
+			flush_locked();
+		}
+	}
+	
+	void flush() {
+		std::lock_guard<std::mutex> guard{mutex};
+		flush_locked();
+	}
+	
+	unsigned depth = 0;
+	
+private:
+	void flush_locked() {
+		if(!events.empty()) {
+			get_sink().write(events, tid);
+			events.clear();
+		}
+	}
+	
+	static constexpr std::size_t capacity = 4096;
+	static std::atomic<unsigned> next_tid;
+	
+	std::vector<trace_event> events;
+	std::mutex mutex;
+	const unsigned tid;
+};
+
+std::atomic<unsigned> thread_buffer::next_tid{1};
+
+void trace_sink::flush_buffers() {
+	for(auto buffer: buffers) {
+		buffer->flush();
+	}
+}
+
+thread_buffer& get_thread_buffer() {
+	thread_local thread_buffer buffer;
+	return buffer;
+}
+
+} // anonymous namespace
+
+namespace settings {
+
+void set_tracefile(const std::string& filename) {
+	get_sink().open(filename);
+}
+
+bool get_tracing() {
+	return get_sink().enabled;
+}
+
+} // namespace settings
+
+void flush_trace() {
+	get_thread_buffer().flush();
+}
+
+namespace impl {
+
+span::span(const location& loc): loc(loc), begin{0}, active{get_sink().enabled} {
+	if(active) {
+		++get_thread_buffer().depth;
+		begin = now();
+	}
+}
+
+span::~span() {
+	if(active) {
+		const auto end = now();
+		auto& buffer = get_thread_buffer();
+		--buffer.depth;
+		buffer.push({loc.file, loc.function, loc.line, event_kind::complete, buffer.depth, begin, end});
+	}
+}
+
+void tracepoint(const location& loc) {
+	if(get_sink().enabled) {
+		auto& buffer = get_thread_buffer();
+		buffer.push({loc.file, loc.function, loc.line, event_kind::instant, buffer.depth, now(), 0});
+	}
+	log(loc, priority::trace, "tracepoint");
+}
+
+} // namespace impl
+
+} // namespace yoga
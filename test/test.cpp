@@ -1,27 +1,377 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
 #include <iostream>
 #include <iomanip>
 #include <vector>
 #include <map>
 #include <forward_list>
+#include <list>
+#include <sstream>
+#include <thread>
+#include <fstream>
+#include <iterator>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 #include "../include/yoga.hpp"
 
 
 int fun2(int i1, int i2) {
+	YOGA_TRACESPAN;
 	YOGA_TRACEF("Calling fun2 with %s and %s", i1, i2);
 	YOGA_TRACEPOINT;
 	return i1+i2;
 }
 
 void fun1() {
+	YOGA_TRACESPAN; YOGA_TRACESPAN;
 	YOGA_TRACEPOINT;
 	fun2(3, 5);
 	YOGA_TRACEPOINT;
 }
 
+// Records a span and keeps its thread alive until the tracefile is closed:
+void trace_in_background(std::atomic<int>& state) {
+	{
+		YOGA_TRACESPAN;
+	}
+	state = 1;
+	while(state != 2) {
+		std::this_thread::sleep_for(std::chrono::milliseconds{1});
+	}
+}
+
 struct unprintable{};
 
+// A range that can only be walked once:
+struct number_stream {
+	std::istream_iterator<int> begin() const {return std::istream_iterator<int>{*stream};}
+	std::istream_iterator<int> end() const {return {};}
+	std::istream* stream;
+};
+
+std::string read_available(int fd) {
+	std::string data;
+	char buffer[4096];
+	ssize_t received;
+	while((received = ::read(fd, buffer, sizeof(buffer))) > 0) {
+		data.append(buffer, static_cast<std::size_t>(received));
+	}
+	return data;
+}
+
+void test_buffered_stdout() {
+	// redirect stdout into a pipe (nothing may be logged until it is restored):
+	std::cout.flush();
+	const int saved_stdout = ::dup(STDOUT_FILENO);
+	int pipe_fds[2];
+	if(::pipe(pipe_fds) != 0) {
+		YOGA_ERROR("could not create a pipe");
+		return;
+	}
+	::fcntl(pipe_fds[0], F_SETFL, O_NONBLOCK);
+	::dup2(pipe_fds[1], STDOUT_FILENO);
+	
+	yoga::settings::set_buffered_stdout(true);
+	yoga::writefln("buffered format: 1:%s, 2:%s", 3, 4.5);
+	yoga::writeln("buffered writeln: ", std::string(10, '*'));
+	const auto before_flush = read_available(pipe_fds[0]);
+	yoga::flush();
+	const auto after_flush = read_available(pipe_fds[0]);
+	yoga::write("buffered write", '\n');
+	const auto before_mode_change = read_available(pipe_fds[0]);
+	yoga::settings::set_buffered_stdout(false);
+	const auto after_mode_change = read_available(pipe_fds[0]);
+	
+	::dup2(saved_stdout, STDOUT_FILENO);
+	::close(saved_stdout);
+	::close(pipe_fds[0]);
+	::close(pipe_fds[1]);
+	
+	if(!before_flush.empty() || !before_mode_change.empty()) {
+		YOGA_ERRORF("Buffered stdout was written before a flush: “%s”, “%s”",
+				before_flush, before_mode_change);
+	}
+	if(after_flush != "buffered format: 1:3, 2:4.5\nbuffered writeln: **********\n") {
+		YOGA_ERRORF("yoga::flush wrote unexpected data: “%s”", after_flush);
+	}
+	if(after_mode_change != "buffered write\n") {
+		YOGA_ERRORF("Disabling the buffer wrote unexpected data: “%s”", after_mode_change);
+	}
+}
+
+std::string reference_hex(const std::vector<unsigned char>& data) {
+	std::string result;
+	char buffer[3];
+	for(auto byte: data) {
+		std::snprintf(buffer, sizeof(buffer), "%02x", byte);
+		result += buffer;
+	}
+	return result;
+}
+
+std::string reference_hexdump(const std::vector<unsigned char>& data) {
+	std::string result;
+	char buffer[24];
+	for(std::size_t offset = 0; offset < data.size(); offset += 16) {
+		if(offset > 0) {
+			result += '\n';
+		}
+		std::snprintf(buffer, sizeof(buffer), "%08zx ", offset);
+		result += buffer;
+		std::string ascii;
+		for(std::size_t i = offset; i < offset + 16; ++i) {
+			result += i - offset == 8 ? "  " : " ";
+			if(i < data.size()) {
+				std::snprintf(buffer, sizeof(buffer), "%02x", data[i]);
+				result += buffer;
+				ascii += std::isprint(data[i]) ? static_cast<char>(data[i]) : '.';
+			} else {
+				result += "  ";
+			}
+		}
+		result += "  |" + ascii + "|";
+	}
+	return result;
+}
+
+void test_hex() {
+	YOGA_INFO("testing hex and hexdump");
+	std::vector<unsigned char> data;
+	for(std::size_t size = 0; size < 300; ++size) {
+		const auto hex = yoga::to_string(yoga::hex{data});
+		if(hex != reference_hex(data)) {
+			YOGA_ERRORF("hex of %s bytes differs from the reference: “%s”", size, hex);
+		}
+		const auto hexdump = yoga::to_string(yoga::hexdump{data});
+		if(hexdump != reference_hexdump(data)) {
+			YOGA_ERRORF("hexdump of %s bytes differs from the reference:\n%s", size, hexdump);
+		}
+		data.push_back(static_cast<unsigned char>(size * 37 + size / 7));
+	}
+	const std::string text = "Hello, world!\n";
+	YOGA_INFO("hex: ", yoga::hex{text}, ", hexdump:\n", yoga::hexdump{text.data(), text.size()});
+	YOGA_INFO("done");
+}
+
+void test_logfile_index() {
+	YOGA_INFO("testing the logfile-index");
+	const std::string filename = "yoga_test.log";
+	std::remove(filename.c_str());
+	std::remove((filename + ".idx").c_str());
+	yoga::settings::set_logfile_index(1);
+	yoga::settings::set_logfile(filename);
+	const auto padding = std::string(100, '.');
+	std::chrono::system_clock::time_point begin, end;
+	for(int i = 0; i < 40; ++i) {
+		if(i == 20) {
+			begin = std::chrono::system_clock::now();
+		}
+		if(i % 2 == 0) {
+			YOGA_DEBUGF("indexed record %s %s", i, padding);
+		} else {
+			YOGA_INFOF("indexed record %s\nwith a second line", i);
+		}
+		if(i == 29) {
+			end = std::chrono::system_clock::now();
+		}
+	}
+	yoga::settings::set_logfile("");
+	yoga::settings::set_logfile_index(0);
+	
+	std::ifstream index{filename + ".idx", std::ios_base::binary | std::ios_base::ate};
+	if(index.tellg() < 2 * 16 || index.tellg() % 16 != 0) {
+		YOGA_ERRORF("The logfile-index has an unexpected size of %s bytes", index.tellg());
+	}
+	std::vector<std::string> records;
+	yoga::read_logfile(filename, begin, end, yoga::priority::info, [&](const yoga::log_record& record) {
+		records.push_back(record.text);
+	});
+	if(records.size() != 5 || records.front().find("indexed record 21\nwith a second line") == std::string::npos
+			|| records.back().find("indexed record 29\n") == std::string::npos) {
+		YOGA_ERRORF("Reading the logfile returned unexpected records: %s", records);
+	}
+	// forge the first record into one that lies in the range: a reader that starts at offset 0
+	// instead of where the index points to would return it as well:
+	{
+		std::fstream logfile{filename, std::ios_base::in | std::ios_base::out | std::ios_base::binary};
+		std::string first_line;
+		std::getline(logfile, first_line);
+		const auto close = first_line.find(']');
+		const auto forged_time = std::to_string(begin.time_since_epoch().count());
+		if(close != forged_time.size() + 1) {
+			YOGA_ERRORF("Unexpected first record in the logfile: “%s”", first_line);
+		}
+		logfile.seekp(0);
+		logfile << '[' << forged_time << "] [Info ]";
+	}
+	records.clear();
+	yoga::read_logfile(filename, begin, end, yoga::priority::info, [&](const yoga::log_record& record) {
+		records.push_back(record.text);
+	});
+	if(records.size() != 5) {
+		YOGA_ERRORF("Reading the logfile didn't skip the records before the indexed offset: %s", records);
+	}
+	
+	// start a new index for the existing logfile:
+	std::remove((filename + ".idx").c_str());
+	yoga::settings::set_logfile_index(1);
+	yoga::settings::set_logfile(filename);
+	begin = std::chrono::system_clock::now();
+	for(int i = 0; i < 20; ++i) {
+		YOGA_INFOF("appended record %s %s", i, padding);
+	}
+	end = std::chrono::system_clock::now();
+	yoga::settings::set_logfile("");
+	yoga::settings::set_logfile_index(0);
+	records.clear();
+	yoga::read_logfile(filename, begin, end, yoga::priority::info, [&](const yoga::log_record& record) {
+		records.push_back(record.text);
+	});
+	if(records.size() != 20 || records.front().find("appended record 0 ") == std::string::npos) {
+		YOGA_ERRORF("Reading the continued logfile returned unexpected records: %s", records);
+	}
+	
+	// rotate the logfile but keep the index; the new file regrows past the indexed offsets:
+	const auto old_size = std::ifstream{filename, std::ios_base::binary | std::ios_base::ate}.tellg();
+	std::ofstream{filename, std::ios_base::binary | std::ios_base::trunc}
+		<< "rotated\n" << std::string(static_cast<std::size_t>(old_size), '#') << '\n';
+	const auto rotated_size = static_cast<std::uint64_t>(old_size) + 9;
+	yoga::settings::set_logfile_index(1);
+	yoga::settings::set_logfile(filename);
+	YOGA_INFO("record after the rotation");
+	yoga::settings::set_logfile("");
+	yoga::settings::set_logfile_index(0);
+	std::ifstream rotated_index{filename + ".idx", std::ios_base::binary};
+	yoga::impl::logfile_index_entry first_entry{0, 0};
+	if(!rotated_index.read(reinterpret_cast<char*>(&first_entry), sizeof(first_entry))
+			|| first_entry.offset != rotated_size) {
+		YOGA_ERRORF("The index of the rotated logfile was continued: first entry at %s, expected %s",
+				first_entry.offset, rotated_size);
+	}
+	std::remove(filename.c_str());
+	std::remove((filename + ".idx").c_str());
+	YOGA_INFO("done");
+}
+
+int listen_on_socket(const std::string& path, int type) {
+	::unlink(path.c_str());
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	std::copy(path.begin(), path.end(), address.sun_path);
+	int fd = ::socket(AF_UNIX, type, 0);
+	if(::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+		YOGA_ERRORF("could not bind to %s", path);
+	}
+	if(type == SOCK_STREAM) {
+		::listen(fd, 1);
+	}
+	return fd;
+}
+
+std::string receive_all(int fd) {
+	std::string data;
+	char buffer[4096];
+	ssize_t received;
+	while((received = ::recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+		data.append(buffer, static_cast<std::size_t>(received));
+		data.push_back('|');
+	}
+	return data;
+}
+
+void test_logsocket() {
+	YOGA_INFO("testing the datagram-logsocket");
+	const std::string dgram_path = "yoga_test_dgram.sock";
+	int dgram_fd = listen_on_socket(dgram_path, SOCK_DGRAM);
+	yoga::settings::set_logsocket(dgram_path);
+	YOGA_INFO("sent to socket");
+	YOGA_WARN("sent to socket as well");
+	yoga::settings::set_logsocket("");
+	auto received = receive_all(dgram_fd);
+	if(received.find("<14>1 ") != 0 || received.find("- - sent to socket|<12>1 ") == std::string::npos) {
+		YOGA_ERRORF("Datagram-socket received unexpected data: “%s”", received);
+	}
+	::close(dgram_fd);
+	::unlink(dgram_path.c_str());
+	YOGA_INFO("done");
+	
+	YOGA_INFO("testing the stream-logsocket");
+	const std::string stream_path = "yoga_test_stream.sock";
+	int stream_fd = listen_on_socket(stream_path, SOCK_STREAM);
+	std::string stream_received;
+	std::thread listener{[&] {
+		int connection = ::accept(stream_fd, nullptr, nullptr);
+		char buffer[4096];
+		ssize_t received;
+		while((received = ::recv(connection, buffer, sizeof(buffer), 0)) > 0) {
+			stream_received.append(buffer, static_cast<std::size_t>(received));
+		}
+		::close(connection);
+	}};
+	yoga::settings::set_logsocket(stream_path, yoga::settings::socket_framing::newline);
+	for(int i = 0; i < 100; ++i) {
+		YOGA_INFOF("stream-record %s", i);
+	}
+	yoga::settings::set_logsocket("");
+	listener.join();
+	if(std::count(stream_received.begin(), stream_received.end(), '\n') != 100
+			|| stream_received.find("[Info ]: stream-record 99\n") == std::string::npos) {
+		YOGA_ERRORF("Stream-socket received unexpected data: “%s”", stream_received);
+	}
+	::close(stream_fd);
+	::unlink(stream_path.c_str());
+	YOGA_INFO("done");
+	
+	YOGA_INFO("testing a logsocket without a collector");
+	const std::string missing_path = "yoga_test_missing.sock";
+	::unlink(missing_path.c_str());
+	yoga::settings::set_logsocket(missing_path);
+	for(int i = 0; i < 20000; ++i) {
+		yoga::impl::log_to_socket({__FILE__, __PRETTY_FUNCTION__, __LINE__}, yoga::priority::info,
+				std::chrono::system_clock::now(), "nobody listens");
+	}
+	// let the worker attempt a few reconnects:
+	std::this_thread::sleep_for(std::chrono::milliseconds{300});
+	const auto dropped_while_open = yoga::settings::get_logsocket_dropped();
+	yoga::settings::set_logsocket("");
+	if(dropped_while_open != 20000 - (1 << 14) || yoga::settings::get_logsocket_dropped() != 20000) {
+		YOGA_ERRORF("A logsocket without collector dropped %s records while open and %s in total",
+				dropped_while_open, yoga::settings::get_logsocket_dropped());
+	}
+	YOGA_INFO("done");
+	
+	YOGA_INFO("testing a logsocket whose collector doesn't read");
+	int stuck_fd = listen_on_socket(stream_path, SOCK_STREAM);
+	yoga::settings::set_logsocket(stream_path, yoga::settings::socket_framing::newline);
+	const auto payload = std::string(100, '.');
+	for(int i = 0; i < 20000; ++i) {
+		// bypass the terminal:
+		yoga::impl::log_to_socket({__FILE__, __PRETTY_FUNCTION__, __LINE__}, yoga::priority::info,
+				std::chrono::system_clock::now(), payload);
+	}
+	const auto close_begin = std::chrono::steady_clock::now();
+	yoga::settings::set_logsocket("");
+	const auto close_duration = std::chrono::steady_clock::now() - close_begin;
+	if(close_duration > std::chrono::seconds{3} || yoga::settings::get_logsocket_dropped() == 0) {
+		YOGA_ERRORF("Closing a stuck logsocket took %sms and dropped %s records",
+				std::chrono::duration_cast<std::chrono::milliseconds>(close_duration).count(),
+				yoga::settings::get_logsocket_dropped());
+	}
+	::close(stuck_fd);
+	::unlink(stream_path.c_str());
+	YOGA_INFO("done");
+}
+
 int main() {
 	yoga::settings::set_priority(yoga::priority::trace);
 	//yoga::settings::set_print_location(true);
@@ -38,6 +388,11 @@ int main() {
 	YOGA_INFO("done");
 	YOGA_TRACEPOINT;
 	
+	YOGA_INFO("testing buffered stdout");
+	test_buffered_stdout();
+	YOGA_INFO("done");
+	YOGA_TRACEPOINT;
+	
 	YOGA_INFO("testing the swrite-family");
 	std::stringstream stream;
 	yoga::swrite(stream, "foo ", "bar ", "baz");
@@ -49,6 +404,27 @@ int main() {
 	YOGA_INFO("done");
 	YOGA_TRACEPOINT;
 	
+	YOGA_INFO("testing the printing of basic types");
+	enum class some_enum {foo};
+	const auto basic_types = yoga::to_string(true, ' ', static_cast<signed char>('a'), short{-3}, 4u,
+			-5ll, 6.5f, 7.25, 8.5l, "bar", std::string{"baz"}, std::make_pair(1, 'c'),
+			static_cast<int>(some_enum::foo), yoga::to_string());
+	if(basic_types != "1 a-34-56.57.258.5barbaz(1, c)0") {
+		YOGA_ERRORF("to_string returned unexpected data: “%s”", basic_types);
+	}
+	std::stringstream manipulated;
+	yoga::swrite(manipulated, std::hex, 255, ' ', std::boolalpha, true);
+	if(yoga::to_string(std::hex, 255) != "ff" || manipulated.str() != "ff true") {
+		YOGA_ERRORF("Manipulators were not applied: “%s”, “%s”", yoga::to_string(std::hex, 255),
+				manipulated.str());
+	}
+	const auto narrow_hex = yoga::to_string(std::hex, -1, ' ', short{-3}, ' ', static_cast<unsigned short>(0xfffe));
+	if(narrow_hex != "ffffffff fffd fffe") {
+		YOGA_ERRORF("Integers were not printed with their original width: “%s”", narrow_hex);
+	}
+	YOGA_INFO("done");
+	YOGA_TRACEPOINT;
+	
 	std::vector<std::map<std::pair<std::string, int>, double>> insane_container{{{std::make_pair("foo", 3), 4.5}}};
 	YOGA_INFO("some insane container: ", insane_container);
 	YOGA_TRACEPOINT;
@@ -57,10 +433,81 @@ int main() {
 	YOGA_INFO("some forward-list contains: ", fwd_list);
 	YOGA_TRACEPOINT;
 	
+	YOGA_INFO("testing arithmetic ranges");
+	const std::vector<double> doubles{-1.5, 0.1, 1e300, 123456789.0};
+	const std::array<int, 3> ints{{-2147483647 - 1, 0, 42}};
+	const std::vector<unsigned char> chars{'a', 'b'};
+	const auto ranges = yoga::to_string(doubles, ints, chars, std::vector<long>{});
+	if(ranges != "[-1.5, 0.1, 1e+300, 1.23457e+08][-2147483648, 0, 42][a, b][]") {
+		YOGA_ERRORF("Arithmetic ranges were printed as “%s”", ranges);
+	}
+	std::stringstream hex_stream;
+	hex_stream << std::hex;
+	yoga::print_to_stream(hex_stream, std::vector<int>{10, 255});
+	if(hex_stream.str() != "[a, ff]") {
+		YOGA_ERRORF("Arithmetic ranges ignored the formatting of the stream: “%s”", hex_stream.str());
+	}
+	YOGA_INFO("done");
+	YOGA_TRACEPOINT;
+	
+	YOGA_INFO("testing limits for containers");
+	yoga::settings::set_max_elements(3);
+	yoga::settings::set_max_depth(2);
+	const auto limited = yoga::to_string(std::vector<int>(1000000, 1), fwd_list,
+			std::vector<std::vector<std::vector<int>>>{{{1}}, {}});
+	if(limited != "[1, 1, 1, ... (999997 more)][3, 4, 5, ... (1 more)][[[...]], []]") {
+		YOGA_ERRORF("Limited containers were printed as “%s”", limited);
+	}
+	std::istringstream numbers{"1 2 3 4 5"};
+	const auto limited_input = yoga::to_string(number_stream{&numbers}, std::list<int>{1, 2, 3, 4, 5});
+	if(limited_input != "[1, 2, 3, ... (more)][1, 2, 3, ... (2 more)]") {
+		YOGA_ERRORF("Limited single-pass ranges were printed as “%s”", limited_input);
+	}
+	yoga::settings::set_max_elements(0);
+	if(yoga::to_string(fwd_list) != "[... (4 more)]") {
+		YOGA_ERRORF("Container without elements was printed as “%s”", yoga::to_string(fwd_list));
+	}
+	yoga::settings::set_max_elements(std::numeric_limits<std::size_t>::max());
+	yoga::settings::set_max_depth(std::numeric_limits<std::size_t>::max());
+	YOGA_INFO("done");
+	YOGA_TRACEPOINT;
+	
 	YOGA_INFO("Calling some annotated function");
 	fun1();
 	YOGA_TRACEPOINT;
 	
+	test_hex();
+	test_logfile_index();
+	test_logsocket();
+	
+	YOGA_INFO("testing trace-spans");
+	yoga::settings::set_tracefile("yoga_test_trace.json");
+	fun1();
+	{
+		std::atomic<int> state{0};
+		std::thread worker{trace_in_background, std::ref(state)};
+		while(state != 1) {
+			std::this_thread::sleep_for(std::chrono::milliseconds{1});
+		}
+		// the worker is still running and hasn't flushed its span:
+		yoga::settings::set_tracefile("");
+		state = 2;
+		worker.join();
+	}
+	{
+		std::ifstream tracefile{"yoga_test_trace.json"};
+		std::string trace{std::istreambuf_iterator<char>{tracefile}, std::istreambuf_iterator<char>{}};
+		if(trace.find("{\"traceEvents\":[") != 0 || trace.find("\"ph\":\"X\"") == std::string::npos
+				|| trace.find("\"depth\":1") == std::string::npos || trace.find("]}") == std::string::npos) {
+			YOGA_ERRORF("Tracefile contains unexpected data: “%s”", trace);
+		}
+		if(trace.find("trace_in_background") == std::string::npos) {
+			YOGA_ERRORF("Tracefile lacks the events of a running thread: “%s”", trace);
+		}
+	}
+	std::remove("yoga_test_trace.json");
+	YOGA_INFO("done");
+	
 	//yoga::writefln("try printing something unprintable: %s", unprintable{});
 	
 	YOGA_WARN("reaching end of programm");